@@ -32,6 +32,8 @@ void VulkanSplatting::start(int scene_path_index) {
 void VulkanSplatting::initialize(int scene_path_index) {
     renderer = std::make_shared<Renderer>(configuration, scene_path_index);
     renderer->initialize();
+    // the scene is on the GPU now, drop our reference so the mapping can be released
+    configuration.sceneAsset.reset();
 }
 
 void VulkanSplatting::run() {
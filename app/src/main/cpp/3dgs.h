@@ -10,6 +10,8 @@
 #include <android/asset_manager_jni.h>
 
 #include "base_utils.h"
+#include "MappedAsset.h"
+#include "Trajectory.h"
 
 class Window;
 class Renderer;
@@ -20,7 +22,7 @@ public:
         bool enableVulkanValidationLayers = false;
         std::optional<uint8_t> physicalDeviceId = std::nullopt;
         bool immediateSwapchain = false;
-        std::string assetContent;
+        std::shared_ptr<MappedAsset> sceneAsset;
 
         float fov = 45.0f;
         float cameraNear = 0.2f;
@@ -28,9 +30,36 @@ public:
         bool enableGui = false;
 
         ProfilingMode profilingMode = NONE;
-        std::vector<glm::mat3x3> rotations;
-        std::vector<glm::vec3> translations;
+        // poses replayed by the PSNR and PRUNE profiling modes
+        std::vector<CameraPose> trajectory;
         AAssetManager * assetManager;
+        // converted scenes are cached here between launches, empty disables the cache
+        std::string cacheDir;
+        // cap on the host staging memory used while uploading a scene
+        size_t stagingBudget = 32 * 1024 * 1024;
+        SplatStorage splatStorage = SplatStorage::FLOAT32;
+        // 0-3, lower degrees trade view-dependent color for memory and preprocess time
+        uint32_t maxShDegree = 3;
+        // draw the most important splats while the rest of the scene is still uploading
+        bool progressiveLoad = false;
+        // device memory for splats and cov3D, larger scenes are streamed in spatial chunks; 0 = unlimited
+        size_t residencyBudget = 0;
+        // Morton order improves cache locality in preprocess and render; progressive loads use importance order
+        SplatOrder splatOrder = SplatOrder::MORTON;
+        // the opacity default only drops splats render.comp would never blend
+        PruneOptions pruning{0.5f / 255.0f};
+        // device memory for scenes kept loaded after switching away from them, 0 reloads on every switch
+        size_t gpuSceneBudget = 512 * 1024 * 1024;
+        // FLOAT32 PLY scenes are converted by a compute shader from the raw records instead of on the CPU
+        bool gpuDecode = true;
+        // splats cover the tiles where their alpha can pass render.comp's threshold instead of a 3 sigma square
+        bool tightExtents = true;
+        // degrees the view direction to a splat may turn before its SH color is re-evaluated, 0 evaluates every frame
+        float colorCacheTolerance = 1.0f;
+        // cached colors are also refreshed for one in this many splats per frame, 0 refreshes only on drift
+        uint32_t colorCacheRefreshPeriod = 16;
+        // assets cycled through on switchScene, the next one loads in the background while the current one renders
+        std::vector<std::string> scenePaths;
 
         std::shared_ptr<Window> window;
     };
@@ -5,8 +5,13 @@
 #include <fstream>
 #include "GSScene.h"
 
-#include <random>
-#include <variant>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <sstream>
 #include "shaders.h"
 
 #include "vulkan/Utils.h"
@@ -16,23 +21,14 @@
 #include "vulkan/Shader.h"
 
 #include "base_utils.h"
-
-struct VertexStorage {
-    glm::vec3 position;
-    glm::vec3 normal;
-    float shs[48];
-    float opacity;
-    glm::vec3 scale;
-    glm::vec4 rotation;
-};
-
-struct VertexStorage2 {
-    glm::vec3 position;
-    glm::vec3 scale;
-    float opacity;
-    glm::vec4 rotation;
-    float shs[48];
-};
+#include "VertexConverter.h"
+#include "SceneCache.h"
+#include "SplatSource.h"
+#include "ShCodebook.h"
+#include "SplatCompression.h"
+#include "SplatPruning.h"
+#include "WorkerPool.h"
+#include "vulkan/StagingRing.h"
 
 void GSScene::printVertex(const GSScene::Vertex &v, bool print_shs) {
     LOGO("position: (%f, %f, %f, %f) \nrotation: (%f, %f, %f, %f) \nscale opacity: (%f, %f, %f, %f)\n",
@@ -52,206 +48,800 @@ void GSScene::printVertex(const GSScene::Vertex &v, bool print_shs) {
     }
 }
 
-void readVertexInto(std::istringstream * plyFile, GSScene::Vertex * vertex, int vertexType){
-//    static_assert(sizeof(VertexStorage) == 62 * sizeof(float));
+void GSScene::load(const std::shared_ptr<VulkanContext>&context) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    resetPeakRss();
+    loadStats.mappedBytes = asset->size();
+
+    // every transfer of this load goes through one bounded set of staging chunks
+    StagingRing stagingRing(context, options.stagingBudget);
+    loadStats.stagingBytes = stagingRing.getCapacity();
+
+    uint64_t sourceHash = 0;
+    if (!options.cacheDir.empty()) {
+        sourceHash = SceneCache::hashContent(asset->data(), asset->size());
+        if (SplatPruning::isEnabled(options.pruning)) {
+            // every set of thresholds is a scene of its own
+            sourceHash ^= SceneCache::hashContent(reinterpret_cast<const char *>(&options.pruning),
+                                                  sizeof(PruneOptions));
+        }
+        auto storage = static_cast<uint32_t>(options.storage);
+        auto order = static_cast<uint32_t>(getSplatOrder());
+        auto cache = SceneCache::open(
+                SceneCache::pathFor(options.cacheDir, sourceHash, storage, options.maxShDegree, order),
+                sourceHash, asset->size(), storage, order);
+        if (cache != nullptr) {
+            shDegree = cache->getHeader().shDegree;
+            if (cache->getHeader().vertexSize == getSplatSize() && fitsResidencyBudget(cache->getHeader().numSplats)) {
+                loadFromCache(context, stagingRing, *cache);
+                finishLoad(startTime);
+                return;
+            }
+            LOGD("Scene cache has another vertex layout, ignoring it");
+        }
+    }
 
-    std::variant<VertexStorage, VertexStorage2> vertexStorage;
+    // every format is decoded in place from the mapping; nothing is copied until the staging chunks
+    auto source = SplatSource::open(*asset);
+    loadStats.format = source->describe();
+    LOGO("Scene format: %s", loadStats.format.c_str());
+    header.numVertices = static_cast<int>(source->getCount());
+    LOGD("num vertexes: %i", header.numVertices);
+    auto fileShDegree = static_cast<uint32_t>(source->getShDegree());
+    shDegree = std::min<uint32_t>({options.maxShDegree, fileShDegree, 3u});
+    LOGO("SH degree %u (file %u, limit %u)", shDegree, fileShDegree, options.maxShDegree);
+
+    // the records stay reachable through the wrappers below, which own the PLY source
+    const PlySplatSource * gpuPly = nullptr;
+    if (options.gpuDecode && options.storage == SplatStorage::FLOAT32) {
+        gpuPly = dynamic_cast<const PlySplatSource *>(source.get());
+        if (gpuPly != nullptr && !canDecodeOnGpu(gpuPly->getLayout())) {
+            LOGO("PLY attributes are not aligned for ply_decode, converting on the CPU");
+            gpuPly = nullptr;
+        }
+    }
 
-    if (vertexType == 1) {
-        vertexStorage = VertexStorage{};
-    } else if (vertexType == 2) {
-        vertexStorage = VertexStorage2{};
-    } else {
-        LOGD("Unknown vertex type");
-    }
-
-    std::visit([&](auto& storage) {
-        plyFile->read(reinterpret_cast<char *>(&vertexStorage), sizeof(storage));
-        vertex->position = glm::vec4(storage.position, 1.0f);
-
-        // verteces[i].normal = glm::vec4(vertexStorage.normal, 0.0f);
-        vertex->scale_opacity = glm::vec4(glm::exp(storage.scale), 1.0f / (1.0f + std::exp(-storage.opacity)));
-        vertex->rotation = normalize(storage.rotation);
-        // memcpy(verteces[i].shs, vertexStorage.shs, 48 * sizeof(float));
-        vertex->shs[0] = storage.shs[0];
-        vertex->shs[1] = storage.shs[1];
-        vertex->shs[2] = storage.shs[2];
-        auto SH_N = 16;
-        for (auto j = 1; j < SH_N; j++) {
-            vertex->shs[j * 3 + 0] = storage.shs[(j - 1) + 3];
-            vertex->shs[j * 3 + 1] = storage.shs[(j - 1) + SH_N + 2];
-            vertex->shs[j * 3 + 2] = storage.shs[(j - 1) + SH_N * 2 + 1];
+    loadStats.convertMs = 0.0;
+    // file index of each splat that survived pruning, empty if pruning is off
+    std::vector<uint32_t> kept;
+    if (SplatPruning::isEnabled(options.pruning)) {
+        kept = prune(*source);
+        source = std::make_unique<ReorderedSplatSource>(std::move(source), kept);
+        header.numVertices = static_cast<int>(kept.size());
+    }
+    // the import order indexes the pruned scene until it is mapped back to the file
+    auto mapOrderToFile = [&]() {
+        if (kept.empty()) {
+            return;
+        }
+        if (importOrder.empty()) {
+            importOrder = std::move(kept);
+            return;
         }
-    }, vertexStorage);
+        for (auto & index: importOrder) {
+            index = kept[index];
+        }
+    };
 
-    // why is this important?
-//    assert(vertexStorage.normal.x == 0.0f);
-//    assert(vertexStorage.normal.y == 0.0f);
-//    assert(vertexStorage.normal.z == 0.0f);
-}
+    source->computeBounds(boundsMin, boundsMax);
 
-void GSScene::loadSmallScene(const std::shared_ptr<VulkanContext>&context){
-    std::istringstream plyFile(assetContent, std::ios::binary);
+    if (!fitsResidencyBudget(header.numVertices)) {
+        loadChunked(context, stagingRing, std::move(source));
+        mapOrderToFile();
+        loadStats.peakRssKb = readPeakRssKb();
+        finishLoad(startTime);
+        return;
+    }
+    if (getSplatOrder() != SplatOrder::FILE_ORDER) {
+        auto orderStart = std::chrono::high_resolution_clock::now();
+        importOrder = getSplatOrder() == SplatOrder::IMPORTANCE
+                      ? ReorderedSplatSource::importanceOrder(*source)
+                      : ReorderedSplatSource::spatialOrder(*source, boundsMin, boundsMax);
+        source = std::make_unique<ReorderedSplatSource>(std::move(source), importOrder);
+        double orderMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - orderStart).count();
+        loadStats.convertMs += orderMs;
+        LOGO("%s order of %i splats in %.1f ms", getSplatOrder() == SplatOrder::IMPORTANCE ? "Importance" : "Morton",
+             header.numVertices, orderMs);
+    }
+    mapOrderToFile();
 
-    int vertexType = loadPlyHeader(plyFile);
+    vertexBuffer = createBuffer(context, header.numVertices * getSplatSize());
+    cov3DBuffer = createBuffer(context, header.numVertices * getCov3DSize());
 
-     header.numVertices = 2;
+    // a batch becomes drawable once its cov3D is computed
+    auto publish = [&](size_t first, size_t count) {
+        residentVertices.store(first + count, std::memory_order_release);
+        if (first == 0) {
+            loadStats.firstBatchMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - startTime).count();
+        }
+    };
+    auto batchEnds = uploadBatches();
+    if (gpuPly != nullptr) {
+        // no color error to measure, only the dropped bands are lost and the CPU never sees the converted SH
+        storageDataBuffer = createBuffer(context, header.numVertices * sizeof(glm::vec4));
+        size_t first = 0;
+        for (size_t end: batchEnds) {
+            decodePly(context, stagingRing, *gpuPly, first, end - first);
+            publish(first, end - first);
+            first = end;
+        }
+        LOGO("Decoded %i splats on the GPU in %.1f ms", header.numVertices, loadStats.gpuDecodeMs);
+    } else if (options.storage == SplatStorage::FLOAT32) {
+        // the streams compute cov3D as part of the upload
+        createStreams(context, header.numVertices);
+        SplatCompression::ColorError colorError;
+        size_t first = 0;
+        for (size_t end: batchEnds) {
+            uploadStreams(context, stagingRing, *source, first, first, end - first, &colorError);
+            publish(first, end - first);
+            first = end;
+        }
+        loadStats.storagePsnr = colorError.psnr();
+    } else {
+        uploadEncoded(context, stagingRing, *source, batchEnds, [&](size_t first, size_t count) {
+            precomputeCov3D(context, first, count);
+            publish(first, count);
+        });
+    }
+    cov3DPipeline.reset();
+    geometryBuffer.reset();
+    decodePipeline.reset();
+    recordBuffer.reset();
+    loadStats.peakRssKb = readPeakRssKb();
+    loadStats.importWorkingBytes = source->getWorkingBytes();
+
+    // the mapping is no longer needed once the vertices are on the GPU
+    source.reset();
+    asset.reset();
+
+    if (!options.cacheDir.empty()) {
+        writeCache(stagingRing, sourceHash);
+    }
+    finishLoad(startTime);
+}
 
-    auto vertexStagingBuffer = Buffer::staging(context, header.numVertices * sizeof(Vertex));
-    auto* verteces = static_cast<Vertex *>(vertexStagingBuffer->allocation_info.pMappedData);
+// Splat count after each upload batch. Progressive loads split the scene into PROGRESSIVE_BATCHES batches, the
+// first of which is drawable after about a tenth of the import; batch starts stay aligned to compression chunks.
+std::vector<size_t> GSScene::uploadBatches() const {
+    auto total = static_cast<size_t>(header.numVertices);
+    if (!options.progressive) {
+        return {total};
+    }
+    constexpr size_t ALIGNMENT = SplatCompression::CHUNK_SIZE;
+    std::vector<size_t> batchEnds;
+    for (size_t batch = 1; batch <= PROGRESSIVE_BATCHES; batch++) {
+        size_t end = std::min(total, (total * batch / PROGRESSIVE_BATCHES + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+        if (batchEnds.empty() || end > batchEnds.back()) {
+            batchEnds.push_back(end);
+        }
+    }
+    return batchEnds;
+}
 
-    readVertexInto(&plyFile, &verteces[0], vertexType);
+SplatOrder GSScene::getSplatOrder() const {
+    if (options.progressive) {
+        return SplatOrder::IMPORTANCE;
+    }
+    if (residency) {
+        // chunks are cut along the Morton curve
+        return SplatOrder::MORTON;
+    }
+    return options.order;
+}
 
-    verteces[1] = verteces[0];
-    verteces[1].position[0] += 5.0f;
+bool GSScene::fitsResidencyBudget(uint64_t numSplats) const {
+    return options.residencyBudget == 0 || numSplats * getResidentSplatSize() <= options.residencyBudget;
+}
 
-    printVertex(verteces[0], true);
-    printVertex(verteces[1], true);
+size_t GSScene::getSplatSize() const {
+    switch (options.storage) {
+        case SplatStorage::COMPRESSED:
+            return sizeof(CompressedSplat);
+        case SplatStorage::SH_CODEBOOK:
+            return sizeof(CodebookSplat);
+        case SplatStorage::HALF:
+            return sizeof(HalfSplat);
+        default:
+            // the SH stream, only the kept coefficients
+            return 3 * shCoefficientCount(shDegree) * sizeof(float);
+    }
+}
 
-    vertexBuffer = createBuffer(context, header.numVertices * sizeof(Vertex));
-    vertexBuffer->uploadFrom(vertexStagingBuffer);
+size_t GSScene::getCov3DSize() const {
+    switch (options.storage) {
+        case SplatStorage::HALF:
+            return 6 * sizeof(uint16_t);
+        case SplatStorage::FLOAT32:
+            // padded to two vec4 loads
+            return 8 * sizeof(float);
+        default:
+            return 6 * sizeof(float);
+    }
+}
 
-    precomputeCov3D(context);
+size_t GSScene::getResidentSplatSize() const {
+    size_t size = getSplatSize() + getCov3DSize();
+    if (options.storage == SplatStorage::FLOAT32) {
+        size += sizeof(glm::vec4);
+    }
+    return size;
 }
 
+size_t GSScene::getDeviceBytes() const {
+    size_t bytes = 0;
+    for (const auto * buffer: {&vertexBuffer, &cov3DBuffer, &storageDataBuffer}) {
+        bytes += *buffer ? (*buffer)->size : 0;
+    }
+    return bytes;
+}
 
-void GSScene::load(const std::shared_ptr<VulkanContext>&context) {
-//    auto startTime = std::chrono::high_resolution_clock::now();
+// Runs the tests of LoadOptions::pruning over the whole file and reports what they removed
+std::vector<uint32_t> GSScene::prune(const SplatSource & source) {
+    auto pruneStart = std::chrono::high_resolution_clock::now();
+    SplatPruning::Report report;
+    auto kept = SplatPruning::select(source, options.pruning, report);
+    double pruneMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - pruneStart).count();
+    loadStats.convertMs += pruneMs;
+    loadStats.prunedSplats = report.removed();
+    loadStats.prunedBytes = report.removed() * getResidentSplatSize();
+    LOGO("Pruned %zu of %zu splats in %.1f ms (opacity < %g: %zu, volume < %g: %zu, floaters: %zu), %.1f MB saved",
+         report.removed(), report.total, pruneMs, options.pruning.minOpacity, report.lowOpacity,
+         options.pruning.minVolume, report.smallVolume, report.floaters, loadStats.prunedBytes / (1024.0 * 1024.0));
+    return kept;
+}
 
-    std::istringstream plyFile(assetContent, std::ios::binary);
-    int vertexType = loadPlyHeader(plyFile);
+// Trains the codebook on evenly spaced splats of the file
+ShCodebook GSScene::trainShCodebook(const SplatSource & source) {
+    constexpr size_t R = ShCodebook::REST_COEFFICIENTS;
+    size_t keptShFloats = 3 * shCoefficientCount(shDegree);
+    auto trainStart = std::chrono::high_resolution_clock::now();
+    size_t numSamples = std::min<size_t>(header.numVertices, ShCodebook::SIZE * ShCodebook::SAMPLES_PER_ENTRY);
+    std::vector<float> samples(numSamples * R);
+    WorkerPool::shared().parallelFor(numSamples, [&](size_t begin, size_t end) {
+        Vertex v;
+        for (size_t i = begin; i < end; i++) {
+            source.decode(i * header.numVertices / numSamples, 1, &v);
+            std::memcpy(&samples[i * R], v.shs + 3, R * sizeof(float));
+            // dropped bands do not compete for codebook entries
+            std::fill(&samples[i * R] + keptShFloats - 3, &samples[(i + 1) * R], 0.0f);
+        }
+    }, 256);
+    ShCodebook codebook = ShCodebook::train(samples);
+    if (codebook.size() > (1u << 16)) {
+        throw std::runtime_error("SH codebook has more entries than a 16-bit index addresses");
+    }
+    double trainMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - trainStart).count();
+    loadStats.convertMs += trainMs;
+    LOGO("SH codebook: %zu entries trained on %zu splats in %.1f ms, coefficient MSE %g", codebook.size(),
+         numSamples, trainMs, codebook.getTrainingError());
+    return codebook;
+}
 
-    auto vertexStagingBuffer = Buffer::staging(context, header.numVertices * sizeof(Vertex));
-    auto* verteces = static_cast<Vertex *>(vertexStagingBuffer->allocation_info.pMappedData);
-    LOGD("num vertexes: %i", header.numVertices);
+// Sets up the conversion into the resident layout for a GPU buffer of capacity splats and creates the storage
+// data the shaders read next to it (SplatChunk ranges, SH codebook)
+std::unique_ptr<GSScene::Encoder> GSScene::createEncoder(const std::shared_ptr<VulkanContext>&context,
+                                                         StagingRing & stagingRing, const SplatSource & source,
+                                                         size_t capacity) {
+    constexpr size_t ENCODE_BLOCK = SplatCompression::CHUNK_SIZE;
+    auto encoder = std::make_unique<Encoder>();
+    // the lambdas refer to the encoder itself, it is not moved once created
+    Encoder & e = *encoder;
+    switch (options.storage) {
+        case SplatStorage::COMPRESSED:
+            e.chunks.resize((capacity + ENCODE_BLOCK - 1) / ENCODE_BLOCK);
+            e.encode = [&e](const Vertex * src, size_t first, size_t count, char * dst) {
+                e.chunks[first / ENCODE_BLOCK] = SplatCompression::compressChunk(
+                        src, count, reinterpret_cast<CompressedSplat *>(dst));
+            };
+            e.decode = [&e](const char * encoded, size_t index) {
+                return SplatCompression::decompress(e.chunks[index / ENCODE_BLOCK],
+                                                    *reinterpret_cast<const CompressedSplat *>(encoded));
+            };
+            break;
+        case SplatStorage::SH_CODEBOOK:
+            e.codebook = trainShCodebook(source);
+            e.encode = [&e](const Vertex * src, size_t, size_t count, char * dst) {
+                e.codebook.encode(src, count, reinterpret_cast<CodebookSplat *>(dst));
+            };
+            e.decode = [&e](const char * encoded, size_t) {
+                return e.codebook.decode(*reinterpret_cast<const CodebookSplat *>(encoded));
+            };
+            break;
+        case SplatStorage::HALF:
+            e.encode = [](const Vertex * src, size_t, size_t count, char * dst) {
+                for (size_t i = 0; i < count; i++) {
+                    reinterpret_cast<HalfSplat *>(dst)[i] = SplatCompression::toHalf(src[i]);
+                }
+            };
+            e.decode = [](const char * encoded, size_t) {
+                return SplatCompression::fromHalf(*reinterpret_cast<const HalfSplat *>(encoded));
+            };
+            break;
+        default:
+            throw std::runtime_error("FLOAT32 splats are uploaded as streams, not encoded");
+    }
 
-    for (auto i = 0; i < header.numVertices; i++) {
-        readVertexInto(&plyFile, &verteces[i], vertexType);
+    // the shaders read the storage data of every resident splat, so it exists before the first splat
+    if (!e.chunks.empty()) {
+        storageDataBuffer = createBuffer(context, e.chunks.size() * sizeof(SplatChunk));
+    } else if (e.codebook.size() > 0) {
+        storageDataBuffer = createBuffer(context, e.codebook.data().size() * sizeof(float));
+        stagingRing.upload(storageDataBuffer, e.codebook.data().data(), e.codebook.data().size() * sizeof(float));
     }
+    return encoder;
+}
 
-    vertexBuffer = createBuffer(context, header.numVertices * sizeof(Vertex));
-    vertexBuffer->uploadFrom(vertexStagingBuffer);
+// Converts source splats [sourceFirst, sourceFirst + count) into GPU splats [first, first + count) at dst, in
+// blocks of ENCODE_BLOCK aligned to the GPU index (one SplatChunk each for COMPRESSED). With colorError, a sample
+// is decoded again to measure the color error the layout costs.
+void GSScene::encodeRange(const Encoder & encoder, const SplatSource & source, size_t sourceFirst, size_t first,
+                          size_t count, char * dst, SplatCompression::ColorError * colorError) const {
+    constexpr size_t ENCODE_BLOCK = SplatCompression::CHUNK_SIZE;
+    constexpr size_t ERROR_SAMPLE_STRIDE = 16;
+    size_t splatSize = getSplatSize();
+    size_t keptShFloats = 3 * shCoefficientCount(shDegree);
+    std::mutex errorMutex;
+    size_t numBlocks = (count + ENCODE_BLOCK - 1) / ENCODE_BLOCK;
+    WorkerPool::shared().parallelFor(numBlocks, [&](size_t blockBegin, size_t blockEnd) {
+        std::vector<Vertex> converted(ENCODE_BLOCK);
+        std::vector<Vertex> truncated(keptShFloats < 48 ? ENCODE_BLOCK : 0);
+        std::vector<char> encoded(ENCODE_BLOCK * splatSize);
+        SplatCompression::ColorError rangeError;
+        for (size_t block = blockBegin; block < blockEnd; block++) {
+            size_t offset = block * ENCODE_BLOCK;
+            size_t n = std::min(ENCODE_BLOCK, count - offset);
+            source.decode(sourceFirst + offset, n, converted.data());
+            // the error is measured against the full SH, so it includes the dropped bands
+            const Vertex * kept = converted.data();
+            if (!truncated.empty()) {
+                for (size_t i = 0; i < n; i++) {
+                    truncated[i] = converted[i];
+                    std::fill(truncated[i].shs + keptShFloats, truncated[i].shs + 48, 0.0f);
+                }
+                kept = truncated.data();
+            }
+            encoder.encode(kept, first + offset, n, encoded.data());
+            std::memcpy(dst + offset * splatSize, encoded.data(), n * splatSize);
+            if (colorError != nullptr) {
+                for (size_t i = 0; i < n; i += ERROR_SAMPLE_STRIDE) {
+                    rangeError.add(converted[i], encoder.decode(encoded.data() + i * splatSize, first + offset + i));
+                }
+            }
+        }
+        if (colorError != nullptr) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            colorError->merge(rangeError);
+        }
+    }, 1);
+}
 
-    precomputeCov3D(context);
+// Uploads the SplatChunk ranges of GPU splats [first, end); first is chunk aligned, so the chunks are complete
+// once those splats are encoded
+void GSScene::uploadChunkRanges(StagingRing & stagingRing, const Encoder & encoder, size_t first, size_t end) {
+    constexpr size_t ENCODE_BLOCK = SplatCompression::CHUNK_SIZE;
+    if (encoder.chunks.empty()) {
+        return;
+    }
+    size_t firstChunk = first / ENCODE_BLOCK;
+    size_t endChunk = (end + ENCODE_BLOCK - 1) / ENCODE_BLOCK;
+    stagingRing.upload(storageDataBuffer, endChunk - firstChunk, sizeof(SplatChunk),
+                       [&](size_t begin, size_t end, void * mapped) {
+        std::memcpy(mapped, &encoder.chunks[begin], (end - begin) * sizeof(SplatChunk));
+    }, 1, firstChunk);
 }
 
+// FLOAT32 buffers for capacity splats: the SH stream, cov3D, the position stream and a geometry buffer for one
+// upload batch
+void GSScene::createStreams(const std::shared_ptr<VulkanContext>&context, size_t capacity) {
+    storageDataBuffer = createBuffer(context, capacity * sizeof(glm::vec4));
+    geometryBuffer = createBuffer(context, std::min(capacity, GEOMETRY_BATCH) * sizeof(SplatGeometry));
+}
 
-void GSScene::loadTestScene(const std::shared_ptr<VulkanContext>&context) {
-    int testObects = 1;
-    header.numVertices = testObects;
-    vertexBuffer = createBuffer(context, testObects * sizeof(Vertex));
-    auto vertexStagingBuffer = Buffer::staging(context, testObects * sizeof(Vertex));
-    auto* verteces = static_cast<Vertex *>(vertexStagingBuffer->allocation_info.pMappedData);
+// FLOAT32 upload of source splats [sourceFirst, sourceFirst + count) into GPU splats [first, first + count) in
+// batches of GEOMETRY_BATCH. The kept SH go straight into vertexBuffer; position, opacity, scale and rotation go
+// to geometryBuffer, from which precomp_cov3d computes cov3D and the position stream.
+void GSScene::uploadStreams(const std::shared_ptr<VulkanContext>&context, StagingRing & stagingRing,
+                            const SplatSource & source, size_t sourceFirst, size_t first, size_t count,
+                            SplatCompression::ColorError * colorError) {
+    constexpr size_t DECODE_BLOCK = 1024;
+    constexpr size_t ERROR_SAMPLE_STRIDE = 16;
+    size_t keptShFloats = 3 * shCoefficientCount(shDegree);
+    std::vector<SplatGeometry> geometry(std::min(count, GEOMETRY_BATCH));
+    std::mutex errorMutex;
+    for (size_t batchFirst = 0; batchFirst < count; batchFirst += GEOMETRY_BATCH) {
+        size_t batchCount = std::min(GEOMETRY_BATCH, count - batchFirst);
+        stagingRing.upload(vertexBuffer, batchCount, getSplatSize(), [&](size_t begin, size_t end, void * mapped) {
+            auto convertStart = std::chrono::high_resolution_clock::now();
+            auto * sh = static_cast<float *>(mapped);
+            WorkerPool::shared().parallelFor(end - begin, [&](size_t rangeBegin, size_t rangeEnd) {
+                std::vector<Vertex> block(DECODE_BLOCK);
+                SplatCompression::ColorError rangeError;
+                for (size_t blockBegin = rangeBegin; blockBegin < rangeEnd; blockBegin += DECODE_BLOCK) {
+                    size_t n = std::min(DECODE_BLOCK, rangeEnd - blockBegin);
+                    // relative to the start of the range
+                    size_t splat = begin - first + blockBegin;
+                    source.decode(sourceFirst + splat, n, block.data());
+                    for (size_t i = 0; i < n; i++) {
+                        const Vertex & v = block[i];
+                        std::memcpy(sh + (blockBegin + i) * keptShFloats, v.shs, keptShFloats * sizeof(float));
+                        geometry[splat + i - batchFirst] = {glm::vec4(glm::vec3(v.position), v.scale_opacity.w),
+                                                            glm::vec4(glm::vec3(v.scale_opacity), 0.0f), v.rotation};
+                    }
+                    if (colorError != nullptr && keptShFloats < 48) {
+                        // the only loss of FLOAT32 are the dropped SH bands
+                        for (size_t i = 0; i < n; i += ERROR_SAMPLE_STRIDE) {
+                            Vertex kept = block[i];
+                            std::fill(kept.shs + keptShFloats, kept.shs + 48, 0.0f);
+                            rangeError.add(block[i], kept);
+                        }
+                    }
+                }
+                if (colorError != nullptr) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    colorError->merge(rangeError);
+                }
+            }, DECODE_BLOCK);
+            loadStats.convertMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - convertStart).count();
+        }, 1, first + batchFirst);
+        stagingRing.upload(geometryBuffer, batchCount, sizeof(SplatGeometry),
+                           [&](size_t begin, size_t end, void * mapped) {
+            std::memcpy(mapped, geometry.data() + begin, (end - begin) * sizeof(SplatGeometry));
+        });
+        precomputeCov3D(context, first + batchFirst, batchCount);
+    }
+}
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> posgen(-3.0, 3.0);
-    std::uniform_real_distribution<> scalegen(100.0, 5000.0);
-    std::uniform_real_distribution<> shsgen(-1.0, 1.0);
+// ply_decode reads every attribute from the word or half-word it is aligned to
+bool GSScene::canDecodeOnGpu(const PlyVertexLayout & layout) {
+    size_t attributeSize = plyTypeSize(layout.attributeType);
+    std::vector<size_t> offsets = {layout.stride, layout.opacity, layout.shDc, layout.shRest};
+    offsets.insert(offsets.end(), std::begin(layout.position), std::end(layout.position));
+    offsets.insert(offsets.end(), std::begin(layout.scale), std::end(layout.scale));
+    offsets.insert(offsets.end(), std::begin(layout.rotation), std::end(layout.rotation));
+    return std::all_of(offsets.begin(), offsets.end(), [&](size_t offset) { return offset % attributeSize == 0; });
+}
 
+// FLOAT32 upload of GPU splats [first, first + count) straight from the PLY records (LoadOptions::gpuDecode). The
+// records are copied as they are, in batches of GEOMETRY_BATCH; ply_decode writes the SH stream, the position
+// stream and cov3D from them. Reordered or pruned scenes gather whole records through importOrder.
+void GSScene::decodePly(const std::shared_ptr<VulkanContext>&context, StagingRing & stagingRing,
+                        const PlySplatSource & ply, size_t first, size_t count) {
+    const PlyVertexLayout & layout = ply.getLayout();
+    const char * records = ply.getRecords();
+    size_t stride = layout.stride;
+    if (!decodePipeline) {
+        // padded to whole words, the shader reads the records as uints
+        size_t batchBytes = std::min<size_t>(header.numVertices, GEOMETRY_BATCH) * stride;
+        recordBuffer = createBuffer(context, (batchBytes + 3) / 4 * 4);
+
+        auto shader = std::make_shared<Shader>(context, "ply_decode", SPV_PLY_DECODE, SPV_PLY_DECODE_len);
+        decodePipeline = std::make_shared<ComputePipeline>(context, shader);
+        auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+        descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 recordBuffer);
+        descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 vertexBuffer);
+        descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 storageDataBuffer);
+        descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 cov3DBuffer);
+        descriptorSet->build();
+
+        decodePipeline->addDescriptorSet(0, descriptorSet);
+        decodePipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PlyDecodeLayout));
+        decodePipeline->addSpecializationConstant(0, shDegree);
+        decodePipeline->addSpecializationConstant(1, static_cast<uint32_t>(layout.shDegree));
+        decodePipeline->addSpecializationConstant(2, layout.attributeType == PlyType::FLOAT16);
+        decodePipeline->build();
+    }
 
-    for (auto i = 0; i < testObects; i++) {
-        verteces[i].position = glm::vec4(posgen(gen), posgen(gen), posgen(gen), 1.0f);
-        // verteces[i].normal = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-        verteces[i].scale_opacity = glm::vec4(scalegen(gen), scalegen(gen), scalegen(gen), 0.5f);
-        verteces[i].rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        for (auto j = 0; j < 48; j++) {
-            verteces[i].shs[j] = shsgen(gen);
-        }
+    PlyDecodeLayout decodeLayout{};
+    decodeLayout.stride = static_cast<uint32_t>(stride);
+    for (int i = 0; i < 3; i++) {
+        decodeLayout.position[i] = static_cast<uint32_t>(layout.position[i]);
+        decodeLayout.scale[i] = static_cast<uint32_t>(layout.scale[i]);
+    }
+    decodeLayout.opacity = static_cast<uint32_t>(layout.opacity);
+    for (int i = 0; i < 4; i++) {
+        decodeLayout.rotation[i] = static_cast<uint32_t>(layout.rotation[i]);
+    }
+    decodeLayout.shDc = static_cast<uint32_t>(layout.shDc);
+    decodeLayout.shRest = static_cast<uint32_t>(layout.shRest);
+
+    for (size_t batchFirst = 0; batchFirst < count; batchFirst += GEOMETRY_BATCH) {
+        size_t batchCount = std::min(GEOMETRY_BATCH, count - batchFirst);
+        // GPU index of the first record in the batch
+        size_t splat = first + batchFirst;
+        stagingRing.upload(recordBuffer, batchCount, stride, [&](size_t begin, size_t end, void * mapped) {
+            auto copyStart = std::chrono::high_resolution_clock::now();
+            auto * dst = static_cast<char *>(mapped);
+            if (importOrder.empty()) {
+                std::memcpy(dst, records + (splat + begin) * stride, (end - begin) * stride);
+            } else {
+                WorkerPool::shared().parallelFor(end - begin, [&](size_t rangeBegin, size_t rangeEnd) {
+                    for (size_t i = rangeBegin; i < rangeEnd; i++) {
+                        std::memcpy(dst + i * stride, records + importOrder[splat + begin + i] * stride, stride);
+                    }
+                }, 4096);
+            }
+            loadStats.convertMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - copyStart).count();
+        });
+
+        auto decodeStart = std::chrono::high_resolution_clock::now();
+        decodeLayout.firstSplat = static_cast<uint32_t>(splat);
+        decodeLayout.splatRange = static_cast<uint32_t>(batchCount);
+        auto commandBuffer = context->beginOneTimeCommandBuffer(VulkanContext::Queue::TRANSFER);
+        decodePipeline->bind(commandBuffer, 0, 0);
+        commandBuffer->pushConstants(decodePipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
+                                     sizeof(PlyDecodeLayout), &decodeLayout);
+        commandBuffer->dispatch(static_cast<uint32_t>((batchCount + 255) / 256), 1, 1);
+        context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::TRANSFER);
+        loadStats.gpuDecodeMs += std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - decodeStart).count();
     }
+}
 
-    vertexBuffer->uploadFrom(vertexStagingBuffer);
+// Streams the scene through the staging ring batch by batch: convert, encode into the resident layout and
+// measure the color PSNR the layout costs
+void GSScene::uploadEncoded(const std::shared_ptr<VulkanContext>&context, StagingRing & stagingRing,
+                            const SplatSource & source, const std::vector<size_t> & batchEnds,
+                            const std::function<void(size_t, size_t)> & onBatch) {
+    constexpr size_t ENCODE_BLOCK = SplatCompression::CHUNK_SIZE;
+    size_t splatSize = getSplatSize();
+    auto encoder = createEncoder(context, stagingRing, source, header.numVertices);
+
+    SplatCompression::ColorError colorError;
+    auto fill = [&](size_t begin, size_t end, void * mapped) {
+        auto convertStart = std::chrono::high_resolution_clock::now();
+        encodeRange(*encoder, source, begin, begin, end - begin, static_cast<char *>(mapped), &colorError);
+        loadStats.convertMs += std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - convertStart).count();
+    };
+
+    size_t batchFirst = 0;
+    for (size_t batchEnd: batchEnds) {
+        stagingRing.upload(vertexBuffer, batchEnd - batchFirst, splatSize, fill, ENCODE_BLOCK, batchFirst);
+        // batches start on a chunk boundary
+        uploadChunkRanges(stagingRing, *encoder, batchFirst, batchEnd);
+        onBatch(batchFirst, batchEnd - batchFirst);
+        batchFirst = batchEnd;
+    }
+    loadStats.storagePsnr = colorError.psnr();
+    // what stays resident, not only the encoded record
+    double sharedBytes = storageDataBuffer
+                         ? static_cast<double>(storageDataBuffer->size) / std::max<uint64_t>(header.numVertices, 1) : 0.0;
+    LOGO("Encoded splats: %.1f bytes resident per splat (%zu encoded + %zu cov3D + %.2f shared, from %zu), "
+         "SH color PSNR over sampled view directions %.2f dB", getResidentSplatSize() + sharedBytes, splatSize,
+         getCov3DSize(), sharedBytes, sizeof(Vertex), loadStats.storagePsnr);
+}
 
-    precomputeCov3D(context);
+// Scenes over the residency budget stay in the mapped file. The splats are put in Morton order and cut into chunks
+// of RESIDENCY_CHUNK_SPLATS, the GPU buffers hold as many chunk slots as the budget allows and the
+// ResidencyManager streams the chunks near the camera into them. Not written to the scene cache.
+void GSScene::loadChunked(const std::shared_ptr<VulkanContext>&context, StagingRing & stagingRing,
+                          std::unique_ptr<SplatSource> source) {
+    constexpr size_t CHUNK = RESIDENCY_CHUNK_SPLATS;
+    auto orderStart = std::chrono::high_resolution_clock::now();
+    importOrder = ReorderedSplatSource::spatialOrder(*source, boundsMin, boundsMax);
+    streamSource = std::make_unique<ReorderedSplatSource>(std::move(source), importOrder);
+
+    // chunk bounds include 3 sigma of the largest axis, the extent preprocess draws a splat with
+    size_t numSplats = header.numVertices;
+    std::vector<ResidencyManager::Chunk> chunks((numSplats + CHUNK - 1) / CHUNK);
+    WorkerPool::shared().parallelFor(chunks.size(), [&](size_t begin, size_t end) {
+        std::vector<Vertex> block(CHUNK);
+        for (size_t c = begin; c < end; c++) {
+            auto & chunk = chunks[c];
+            chunk.first = c * CHUNK;
+            chunk.count = std::min(CHUNK, numSplats - chunk.first);
+            streamSource->decode(chunk.first, chunk.count, block.data());
+            chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            chunk.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+            for (size_t i = 0; i < chunk.count; i++) {
+                glm::vec3 scale = glm::vec3(block[i].scale_opacity);
+                float extent = 3.0f * std::max({scale.x, scale.y, scale.z});
+                chunk.boundsMin = glm::min(chunk.boundsMin, glm::vec3(block[i].position) - extent);
+                chunk.boundsMax = glm::max(chunk.boundsMax, glm::vec3(block[i].position) + extent);
+            }
+        }
+    }, 1);
+    loadStats.convertMs += std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - orderStart).count();
+
+    size_t slotBytes = CHUNK * getResidentSplatSize();
+    auto slotCount = static_cast<uint32_t>(std::min(chunks.size(), options.residencyBudget / slotBytes));
+    if (slotCount == 0) {
+        throw std::runtime_error("Residency budget does not fit a single chunk");
+    }
+    size_t capacity = static_cast<size_t>(slotCount) * CHUNK;
+    vertexBuffer = createBuffer(context, capacity * getSplatSize());
+    cov3DBuffer = createBuffer(context, capacity * getCov3DSize());
+    if (options.storage == SplatStorage::FLOAT32) {
+        createStreams(context, capacity);
+    } else {
+        streamEncoder = createEncoder(context, stagingRing, *streamSource, capacity);
+    }
+    streamRing = std::make_unique<StagingRing>(context, options.stagingBudget);
+    loadStats.stagingBytes += streamRing->getCapacity();
+    loadStats.importWorkingBytes = streamSource->getWorkingBytes();
+
+    LOGO("Out-of-core scene: %zu chunks of %zu splats, %u resident (%.1f MB)", chunks.size(), CHUNK, slotCount,
+         slotCount * slotBytes / (1024.0 * 1024.0));
+    residency = std::make_unique<ResidencyManager>(std::move(chunks), slotCount, static_cast<uint32_t>(CHUNK),
+                                                   [this, context](size_t chunk, uint32_t slot) {
+        streamChunk(context, chunk, slot);
+    });
+    // every slot passes the resident range, empty ones are culled through the slot table
+    residentVertices.store(capacity, std::memory_order_release);
 }
 
-// return the type of VertexStorage struct to use (1 or 2)
-// to make it simple, right now it's 1 if there are 62 properties and 2 if not
-int GSScene::loadPlyHeader(std::istringstream& plyFile) {
-    std::string line;
-    bool headerEnd = false;
-    int propertyCount = 0;
-    while (std::getline(plyFile, line)) {
-        std::istringstream iss(line);
-        std::string token;
+// Runs on the residency loader thread: encodes the chunk straight into its slot and computes its cov3D
+void GSScene::streamChunk(const std::shared_ptr<VulkanContext>&context, size_t chunk, uint32_t slot) {
+    constexpr size_t ENCODE_BLOCK = SplatCompression::CHUNK_SIZE;
+    const auto & range = residency->getChunk(chunk);
+    size_t first = static_cast<size_t>(slot) * residency->getSlotCapacity();
+    if (!streamEncoder) {
+        uploadStreams(context, *streamRing, *streamSource, range.first, first, range.count, nullptr);
+        return;
+    }
+    streamRing->upload(vertexBuffer, range.count, getSplatSize(), [&](size_t begin, size_t end, void * mapped) {
+        encodeRange(*streamEncoder, *streamSource, range.first + (begin - first), begin, end - begin,
+                    static_cast<char *>(mapped), nullptr);
+    }, ENCODE_BLOCK, first);
+    uploadChunkRanges(*streamRing, *streamEncoder, first, first + range.count);
+    precomputeCov3D(context, first, range.count);
+}
 
-        iss >> token;
+// Cached scenes are already in GPU layout: each section is a bulk copy through the staging ring,
+// no conversion, no cov3D pass
+void GSScene::loadFromCache(const std::shared_ptr<VulkanContext>&context, StagingRing & stagingRing,
+                            const SceneCache & cache) {
+    const SceneCacheHeader & cacheHeader = cache.getHeader();
+    header.numVertices = static_cast<int>(cacheHeader.numSplats);
+    boundsMin = glm::vec3(cacheHeader.boundsMin[0], cacheHeader.boundsMin[1], cacheHeader.boundsMin[2]);
+    boundsMax = glm::vec3(cacheHeader.boundsMax[0], cacheHeader.boundsMax[1], cacheHeader.boundsMax[2]);
 
-        if (token == "ply") {
-            // PLY format indicator
-        }
-        else if (token == "format") {
-            iss >> header.format;
-        }
-        else if (token == "element") {
-            iss >> token;
+    vertexBuffer = createBuffer(context, cacheHeader.vertexBytes);
+    stagingRing.upload(vertexBuffer, cache.vertexData(), cacheHeader.vertexBytes);
 
-            if (token == "vertex") {
-                iss >> header.numVertices;
-            }
-            else if (token == "face") {
-                iss >> header.numFaces;
-            }
-        }
-        else if (token == "property") {
-            propertyCount++;
-            PlyProperty property;
-            iss >> property.type >> property.name;
+    cov3DBuffer = createBuffer(context, cacheHeader.cov3DBytes);
+    stagingRing.upload(cov3DBuffer, cache.cov3DData(), cacheHeader.cov3DBytes);
 
-            if (header.vertexProperties.size() < static_cast<size_t>(header.numVertices)) {
-                header.vertexProperties.push_back(property);
-            }
-            else {
-                header.faceProperties.push_back(property);
-            }
-        }
-        else if (token == "end_header") {
-            headerEnd = true;
-            break;
+    if (cacheHeader.storageDataBytes > 0) {
+        storageDataBuffer = createBuffer(context, cacheHeader.storageDataBytes);
+        stagingRing.upload(storageDataBuffer, cache.storageData(), cacheHeader.storageDataBytes);
+    }
+    importOrder.assign(cache.orderData(), cache.orderData() + cacheHeader.orderBytes / sizeof(uint32_t));
+    loadStats.storagePsnr = cacheHeader.storagePsnr;
+
+    loadStats.fromCache = true;
+    loadStats.peakRssKb = readPeakRssKb();
+    // already in GPU layout, a bulk copy is quick enough not to stream it in batches
+    residentVertices.store(header.numVertices, std::memory_order_release);
+    asset.reset();
+}
+
+// Reads the converted vertices and cov3D back once and stores them for the next launch.
+// A failed write only costs the next launch a full import, so it is logged rather than thrown.
+void GSScene::writeCache(StagingRing & stagingRing, uint64_t sourceHash) {
+    auto writeStart = std::chrono::high_resolution_clock::now();
+    try {
+        SceneCacheHeader cacheHeader{};
+        cacheHeader.vertexSize = getSplatSize();
+        cacheHeader.storage = static_cast<uint32_t>(options.storage);
+        cacheHeader.storagePsnr = static_cast<float>(loadStats.storagePsnr);
+        cacheHeader.shDegree = shDegree;
+        cacheHeader.splatOrder = static_cast<uint32_t>(getSplatOrder());
+        cacheHeader.sourceHash = sourceHash;
+        cacheHeader.sourceSize = loadStats.mappedBytes;
+        cacheHeader.numSplats = header.numVertices;
+        for (int axis = 0; axis < 3; axis++) {
+            cacheHeader.boundsMin[axis] = boundsMin[axis];
+            cacheHeader.boundsMax[axis] = boundsMax[axis];
         }
+        cacheHeader.vertexBytes = vertexBuffer->size;
+        cacheHeader.cov3DBytes = cov3DBuffer->size;
+        cacheHeader.storageDataBytes = storageDataBuffer ? storageDataBuffer->size : 0;
+        cacheHeader.orderBytes = importOrder.size() * sizeof(uint32_t);
+        SceneCache::write(SceneCache::pathFor(options.cacheDir, sourceHash, cacheHeader.storage, options.maxShDegree,
+                                              cacheHeader.splatOrder),
+                          cacheHeader,
+                          [&](SceneCache::Section section, std::ostream & out) {
+            if (section == SceneCache::Section::ORDER) {
+                out.write(reinterpret_cast<const char *>(importOrder.data()), cacheHeader.orderBytes);
+                return;
+            }
+            auto & buffer = section == SceneCache::Section::VERTICES ? vertexBuffer
+                          : section == SceneCache::Section::COV3D ? cov3DBuffer : storageDataBuffer;
+            stagingRing.download(buffer, buffer->size, [&](size_t, const void * data, size_t bytes) {
+                out.write(static_cast<const char *>(data), bytes);
+            });
+        });
+    } catch (const std::exception & e) {
+        LOGO("Could not write scene cache: %s", e.what());
+        return;
     }
+    LOGO("Wrote scene cache in %.1f ms", std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - writeStart).count());
+}
 
-    if (!headerEnd) {
-        throw std::runtime_error("Could not find end of header");
+void GSScene::finishLoad(std::chrono::high_resolution_clock::time_point startTime) {
+    loadStats.loadMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+    if (loadStats.firstBatchMs == 0.0) {
+        loadStats.firstBatchMs = loadStats.loadMs;
     }
-    LOGD("PROPERTY COUNT: %i", propertyCount);
-    return (propertyCount == 62) ? 1 : 2;
+    LOGO("Loaded %i splats in %.1f ms (%s, conversion %.1f ms): mapping %.1f MB, import working set %.1f MB, "
+         "staging %.1f MB, peak RSS %.1f MB",
+         header.numVertices, loadStats.loadMs, loadStats.fromCache ? "scene cache" : loadStats.format.c_str(),
+         loadStats.convertMs, loadStats.mappedBytes / (1024.0 * 1024.0),
+         loadStats.importWorkingBytes / (1024.0 * 1024.0), loadStats.stagingBytes / (1024.0 * 1024.0),
+         loadStats.peakRssKb / 1024.0);
 }
 
 std::shared_ptr<Buffer> GSScene::createBuffer(const std::shared_ptr<VulkanContext>&context, size_t i) {
     return std::make_shared<Buffer>(
-        context, i, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        context, i, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                    vk::BufferUsageFlagBits::eTransferSrc,
         VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, false);
 }
 
-// After loading verteces from .ply input file
-// Calculate the upper triangle of the 3x3 covariance matrix for each Gaussian/vertex
-// This matrix captures the scale and rotation of each Gaussian
-void GSScene::precomputeCov3D(const std::shared_ptr<VulkanContext>&context) {
-    cov3DBuffer = createBuffer(context, header.numVertices * sizeof(float) * 6);
-
-    auto pipeline = std::make_shared<ComputePipeline>(
-        context, std::make_shared<Shader>(context, "precomp_cov3d", SPV_PRECOMP_COV3D, SPV_PRECOMP_COV3D_len));
-
-    auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
-    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             vertexBuffer);
-    descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
-                                             cov3DBuffer);
-    descriptorSet->build();
-
-    pipeline->addDescriptorSet(0, descriptorSet);
-    pipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(float));
-    pipeline->build();
-
-    auto commandBuffer = context->beginOneTimeCommandBuffer();
-    pipeline->bind(commandBuffer, 0, 0);
-    float scaleFactor = 1.0f;
-    commandBuffer->pushConstants(pipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
-                                 sizeof(float), &scaleFactor);
-    int numGroups = (header.numVertices + 255) / 256;
-    commandBuffer->dispatch(numGroups, 1, 1);
-    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
+// Computes the upper triangle of the 3x3 covariance matrix, which captures the scale and rotation of each Gaussian,
+// for splats [first, first + count); the pipeline is kept until the load drops it.
+void GSScene::precomputeCov3D(const std::shared_ptr<VulkanContext>&context, size_t first, size_t count) {
+    if (!cov3DPipeline) {
+        std::shared_ptr<Shader> shader;
+        switch (options.storage) {
+            case SplatStorage::COMPRESSED:
+                shader = std::make_shared<Shader>(context, "precomp_cov3d_compressed", SPV_PRECOMP_COV3D_COMPRESSED,
+                                                  SPV_PRECOMP_COV3D_COMPRESSED_len);
+                break;
+            case SplatStorage::SH_CODEBOOK:
+                shader = std::make_shared<Shader>(context, "precomp_cov3d_sh_codebook", SPV_PRECOMP_COV3D_SH_CODEBOOK,
+                                                  SPV_PRECOMP_COV3D_SH_CODEBOOK_len);
+                break;
+            case SplatStorage::HALF:
+                shader = std::make_shared<Shader>(context, "precomp_cov3d_half", SPV_PRECOMP_COV3D_HALF,
+                                                  SPV_PRECOMP_COV3D_HALF_len);
+                break;
+            default:
+                shader = std::make_shared<Shader>(context, "precomp_cov3d", SPV_PRECOMP_COV3D, SPV_PRECOMP_COV3D_len);
+        }
+        cov3DPipeline = std::make_shared<ComputePipeline>(context, shader);
+
+        auto descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+        descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 vertexBuffer);
+        descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                 cov3DBuffer);
+        if (storageDataBuffer) {
+            descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                     storageDataBuffer);
+        }
+        if (geometryBuffer) {
+            descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                                     geometryBuffer);
+        }
+        descriptorSet->build();
 
-    spdlog::info("Precomputed Cov3D");
+        cov3DPipeline->addDescriptorSet(0, descriptorSet);
+        cov3DPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(Cov3DRange));
+        cov3DPipeline->addSpecializationConstant(0, shDegree);
+        cov3DPipeline->build();
+    }
+
+    auto commandBuffer = context->beginOneTimeCommandBuffer(VulkanContext::Queue::TRANSFER);
+    cov3DPipeline->bind(commandBuffer, 0, 0);
+    Cov3DRange range{1.0f, static_cast<uint32_t>(first), static_cast<uint32_t>(count)};
+    commandBuffer->pushConstants(cov3DPipeline->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0,
+                                 sizeof(Cov3DRange), &range);
+    auto numGroups = static_cast<uint32_t>((count + 255) / 256);
+    commandBuffer->dispatch(numGroups, 1, 1);
+    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::TRANSFER);
 }
@@ -1,46 +1,120 @@
 #ifndef GSSCENE_H
 #define GSSCENE_H
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <iostream>
 #include <glm/glm.hpp>
 #include "vulkan/VulkanContext.h"
 #include "vulkan/Buffer.h"
-
-struct PlyProperty {
-    std::string type;
-    std::string name;
-};
-
-struct PlyHeader {
-    std::string format;
-    int numVertices;
-    int numFaces;
-    std::vector<PlyProperty> vertexProperties;
-    std::vector<PlyProperty> faceProperties;
-};
+#include "vulkan/StagingRing.h"
+#include "vulkan/pipelines/ComputePipeline.h"
+#include "base_utils.h"
+#include "MappedAsset.h"
+#include "PlyHeader.h"
+#include "ResidencyManager.h"
+#include "SceneCache.h"
+#include "ShCodebook.h"
+#include "SplatCompression.h"
+#include "SplatSource.h"
+#include "VertexConverter.h"
 
 class GSScene {
 public:
-    explicit GSScene(std::string & assetContent)
-        : assetContent(assetContent) {}
+    struct LoadOptions {
+        // converted scenes are kept here between launches, empty disables the scene cache
+        std::string cacheDir;
+        // host memory used for staging chunks, independent of the scene size
+        size_t stagingBudget = StagingRing::DEFAULT_CAPACITY;
+        SplatStorage storage = SplatStorage::FLOAT32;
+        // higher SH bands are dropped at load time; FLOAT32 stores only the kept coefficients
+        uint32_t maxShDegree = 3;
+        // import in importance order and publish the splats in PROGRESSIVE_BATCHES batches while loading
+        bool progressive = false;
+        // device memory for splats and cov3D; larger scenes stay in the mapped file and only the chunks near
+        // the camera are resident. 0 keeps every scene fully resident
+        size_t residencyBudget = 0;
+        // ignored by progressive loads, those upload in importance order
+        SplatOrder order = SplatOrder::FILE_ORDER;
+        // splats failing these tests are dropped before anything else sees the scene
+        PruneOptions pruning;
+        // FLOAT32 PLY scenes upload the raw vertex records and convert them in ply_decode.comp, the CPU only copies
+        // bytes. Out-of-core scenes and other formats always convert on the CPU.
+        bool gpuDecode = false;
+    };
 
-    void load(const std::shared_ptr<VulkanContext>& context);
+    static constexpr size_t PROGRESSIVE_BATCHES = 10;
+
+    // splats per chunk of an out-of-core scene, a multiple of SplatCompression::CHUNK_SIZE
+    static constexpr size_t RESIDENCY_CHUNK_SPLATS = 16384;
 
-    void loadTestScene(const std::shared_ptr<VulkanContext>& context);
+    explicit GSScene(std::shared_ptr<MappedAsset> asset, LoadOptions options = {})
+        : asset(std::move(asset)), options(std::move(options)) {}
 
-    void loadSmallScene(const std::shared_ptr<VulkanContext>&context);
+    void load(const std::shared_ptr<VulkanContext>& context);
 
+    // splats the GPU buffers hold: the whole scene, or the slots of an out-of-core scene
     uint64_t getNumVertices() const {
+        return residency ? residency->getCapacity() : header.numVertices;
+    }
+
+    uint64_t getSceneVertices() const {
         return header.numVertices;
     }
 
-    struct Vertex {
-        glm::vec4 position;
-        glm::vec4 scale_opacity;
-        glm::vec4 rotation;
-        float shs[48];
-    };
+    // order the splats were uploaded in, IMPORTANCE for progressive loads
+    SplatOrder getSplatOrder() const;
+
+    // file index of each GPU splat, empty in SplatOrder::FILE_ORDER without pruning. Exports invert it to restore
+    // the file order.
+    const std::vector<uint32_t> & getImportOrder() const {
+        return importOrder;
+    }
+
+    // null unless the scene exceeded LoadOptions::residencyBudget
+    ResidencyManager * getResidency() const {
+        return residency.get();
+    }
+
+    // Splats [0, getResidentVertices()) are uploaded with their cov3D and may be drawn. Grows batch by batch
+    // during a progressive load; other loads publish the whole scene at once.
+    uint64_t getResidentVertices() const {
+        return residentVertices.load(std::memory_order_acquire);
+    }
+
+    const glm::vec3 & getBoundsMin() const {
+        return boundsMin;
+    }
+
+    const glm::vec3 & getBoundsMax() const {
+        return boundsMax;
+    }
+
+    SplatStorage getStorage() const {
+        return options.storage;
+    }
+
+    // SH degree the shaders are specialized for, min(maxShDegree, degree of the file)
+    uint32_t getShDegree() const {
+        return shDegree;
+    }
+
+    // bytes per splat in vertexBuffer, only the SH stream for FLOAT32
+    size_t getSplatSize() const;
+
+    // bytes per splat in cov3DBuffer
+    size_t getCov3DSize() const;
+
+    // device memory per splat across its per-splat buffers; the chunk ranges or codebook of the packed layouts are
+    // shared and only counted by getDeviceBytes
+    size_t getResidentSplatSize() const;
+
+    // device memory of the buffers the renderer binds, fixed once the first batch is published
+    size_t getDeviceBytes() const;
+
+    using Vertex = SplatVertex;
 
     void printVertex(const Vertex & v, bool print_shs = false);
 
@@ -48,20 +122,153 @@ public:
         float mat[6];
     };
 
+    struct LoadStats {
+        double loadMs = 0.0;
+        double convertMs = 0.0;
+        // until the first batch was drawable, that batch is the whole scene unless the load is progressive
+        double firstBatchMs = 0.0;
+        bool fromCache = false;
+        // PSNR of the SH colors of the quantized storage against the full-precision splats, evaluated for a few view
+        // directions per sampled splat; not a rendered-image PSNR. 0 for lossless storage
+        double storagePsnr = 0.0;
+        // importer and its parameters, empty when loaded from the scene cache
+        std::string format;
+        size_t mappedBytes = 0;
+        // host memory the importer needed besides the mapping (inflated .spz etc)
+        size_t importWorkingBytes = 0;
+        size_t stagingBytes = 0;
+        size_t peakRssKb = 0;
+        // dropped by LoadOptions::pruning and the device memory they would have taken, 0 when loaded from the cache
+        size_t prunedSplats = 0;
+        size_t prunedBytes = 0;
+        // spent waiting for ply_decode, 0 when the CPU converted the splats
+        double gpuDecodeMs = 0.0;
+    };
+
+    const LoadStats & getLoadStats() const {
+        return loadStats;
+    }
+
     std::shared_ptr<Buffer> vertexBuffer;
     std::shared_ptr<Buffer> cov3DBuffer;
+    // chunk ranges (SplatStorage::COMPRESSED), SH codebook (SplatStorage::SH_CODEBOOK) or the position and opacity
+    // stream (FLOAT32)
+    std::shared_ptr<Buffer> storageDataBuffer;
 private:
-    std::string assetContent;
-    std::string poseContent;
+    std::shared_ptr<MappedAsset> asset;
+    LoadOptions options;
     PlyHeader header;
+    LoadStats loadStats;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    uint32_t shDegree = 3;
+    std::atomic<uint64_t> residentVertices{0};
+    std::vector<uint32_t> importOrder;
+    // kept between the batches of one load
+    std::shared_ptr<ComputePipeline> cov3DPipeline;
+
+    // FLOAT32 splat as precomp_cov3d reads it from geometryBuffer (SplatGeometry in shaders/splat_storage.glsl).
+    // Only the batch being uploaded exists on the GPU, rotation and scale are gone once its cov3D is computed.
+    struct SplatGeometry {
+        glm::vec4 positionOpacity;
+        glm::vec4 scale;
+        glm::vec4 rotation;
+    };
+
+    static constexpr size_t GEOMETRY_BATCH = 65536;
+
+    std::shared_ptr<Buffer> geometryBuffer;
+
+    // Converts decoded splats into a packed resident layout (FLOAT32 is uploaded as streams instead):
+    // encode(src, first, count, dst) writes splats [first, first + count) of the GPU buffers, decode(encoded, index)
+    // reads one back
+    struct Encoder {
+        std::function<void(const Vertex *, size_t, size_t, char *)> encode;
+        std::function<Vertex(const char *, size_t)> decode;
+        std::vector<SplatChunk> chunks;
+        ShCodebook codebook;
+    };
+
+    // out-of-core scenes keep the import open, chunks are encoded again whenever they become resident; no encoder
+    // for FLOAT32
+    std::unique_ptr<SplatSource> streamSource;
+    std::unique_ptr<Encoder> streamEncoder;
+    std::unique_ptr<StagingRing> streamRing;
+
+    // push constants of precomp_cov3d
+    struct Cov3DRange {
+        float scaleFactor;
+        uint32_t firstSplat;
+        uint32_t splatRange;
+    };
+
+    // push constants of ply_decode: the batch and the byte offsets of PlyVertexLayout
+    struct PlyDecodeLayout {
+        uint32_t stride;
+        uint32_t firstSplat;
+        uint32_t splatRange;
+        uint32_t position[3];
+        uint32_t scale[3];
+        uint32_t opacity;
+        uint32_t rotation[4];
+        uint32_t shDc;
+        uint32_t shRest;
+    };
+
+    // kept between the batches of one load, like cov3DPipeline
+    std::shared_ptr<ComputePipeline> decodePipeline;
+    std::shared_ptr<Buffer> recordBuffer;
 
     std::shared_ptr<Buffer> createStagingBuffer(const std::shared_ptr<VulkanContext>& sharedPtr, unsigned long i);
 
-    int loadPlyHeader(std::istringstream & plyFile);
+    ShCodebook trainShCodebook(const SplatSource & source);
+
+    std::vector<uint32_t> prune(const SplatSource & source);
+
+    std::vector<size_t> uploadBatches() const;
+
+    bool fitsResidencyBudget(uint64_t numSplats) const;
+
+    std::unique_ptr<Encoder> createEncoder(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing,
+                                           const SplatSource & source, size_t capacity);
+
+    void encodeRange(const Encoder & encoder, const SplatSource & source, size_t sourceFirst, size_t first,
+                     size_t count, char * dst, SplatCompression::ColorError * colorError) const;
+
+    void uploadChunkRanges(StagingRing & stagingRing, const Encoder & encoder, size_t first, size_t end);
+
+    void createStreams(const std::shared_ptr<VulkanContext>& context, size_t capacity);
+
+    void uploadStreams(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing,
+                       const SplatSource & source, size_t sourceFirst, size_t first, size_t count,
+                       SplatCompression::ColorError * colorError);
+
+    static bool canDecodeOnGpu(const PlyVertexLayout & layout);
+
+    void decodePly(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing, const PlySplatSource & ply,
+                   size_t first, size_t count);
+
+    void loadChunked(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing,
+                     std::unique_ptr<SplatSource> source);
+
+    void streamChunk(const std::shared_ptr<VulkanContext>& context, size_t chunk, uint32_t slot);
+
+    void uploadEncoded(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing,
+                       const SplatSource & source, const std::vector<size_t> & batchEnds,
+                       const std::function<void(size_t first, size_t count)> & onBatch);
+
+    void loadFromCache(const std::shared_ptr<VulkanContext>& context, StagingRing & stagingRing, const SceneCache & cache);
+
+    void writeCache(StagingRing & stagingRing, uint64_t sourceHash);
+
+    void finishLoad(std::chrono::high_resolution_clock::time_point startTime);
 
     static std::shared_ptr<Buffer> createBuffer(const std::shared_ptr<VulkanContext>& sharedPtr, size_t i);
 
-    void precomputeCov3D(const std::shared_ptr<VulkanContext>& context);
+    void precomputeCov3D(const std::shared_ptr<VulkanContext>& context, size_t first, size_t count);
+
+    // last member: its loader thread uses everything above and stops first
+    std::unique_ptr<ResidencyManager> residency;
 };
 
 
@@ -0,0 +1,56 @@
+#include "GpuSceneCache.h"
+
+#include "GSScene.h"
+#include "base_utils.h"
+
+std::list<GpuSceneCache::Entry>::iterator GpuSceneCache::find(const std::string & key) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->key == key) {
+            return it;
+        }
+    }
+    return entries.end();
+}
+
+std::shared_ptr<GSScene> GpuSceneCache::acquire(const std::string & key) {
+    auto it = find(key);
+    if (it == entries.end()) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it);
+    return it->scene;
+}
+
+void GpuSceneCache::insert(const std::string & key, std::shared_ptr<GSScene> scene) {
+    if (budget == 0) {
+        return;
+    }
+    erase(key);
+    size_t bytes = scene->getDeviceBytes();
+    if (bytes > budget) {
+        LOGD("Scene %s needs %.1f MB, more than the whole GPU scene cache", key.c_str(), bytes / (1024.0 * 1024.0));
+        return;
+    }
+    while (!entries.empty() && residentBytes + bytes > budget) {
+        evict(std::prev(entries.end()));
+    }
+    entries.push_front(Entry{key, std::move(scene), bytes});
+    residentBytes += bytes;
+}
+
+void GpuSceneCache::erase(const std::string & key) {
+    auto it = find(key);
+    if (it != entries.end()) {
+        residentBytes -= it->bytes;
+        entries.erase(it);
+    }
+}
+
+void GpuSceneCache::evict(std::list<Entry>::iterator entry) {
+    LOGO("Evicting scene %s from the GPU scene cache (%.1f MB)", entry->key.c_str(),
+         entry->bytes / (1024.0 * 1024.0));
+    residentBytes -= entry->bytes;
+    entries.erase(entry);
+}
@@ -0,0 +1,58 @@
+#ifndef GPUSCENECACHE_H
+#define GPUSCENECACHE_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+
+class GSScene;
+
+// Loaded scenes kept on the GPU after the renderer switched away from them, keyed by scene path. Up to `budget`
+// bytes of device memory stay resident; beyond that the least recently shown scenes are dropped. Switching back
+// to a cached scene only rebinds its buffers. The renderer holds its own reference to the scene it draws, so an
+// evicted scene lives on until the renderer lets go of it.
+class GpuSceneCache {
+public:
+    // 0 disables the cache
+    explicit GpuSceneCache(size_t budget = 0) : budget(budget) {}
+
+    // the scene, now the most recently used one, or null
+    std::shared_ptr<GSScene> acquire(const std::string & key);
+
+    // Adds or refreshes the scene as the most recently used one and evicts the least recently used others until
+    // the cache fits the budget. A scene larger than the whole budget is not kept.
+    void insert(const std::string & key, std::shared_ptr<GSScene> scene);
+
+    void erase(const std::string & key);
+
+    size_t getBudget() const { return budget; }
+
+    size_t getResidentBytes() const { return residentBytes; }
+
+    size_t getSceneCount() const { return entries.size(); }
+
+    size_t getHits() const { return hits; }
+
+    size_t getMisses() const { return misses; }
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<GSScene> scene;
+        size_t bytes = 0;
+    };
+
+    std::list<Entry>::iterator find(const std::string & key);
+
+    void evict(std::list<Entry>::iterator entry);
+
+    size_t budget;
+    size_t residentBytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    // most recently used first; a handful of scenes, a linear search is enough
+    std::list<Entry> entries;
+};
+
+#endif //GPUSCENECACHE_H
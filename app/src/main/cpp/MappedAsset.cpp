@@ -0,0 +1,66 @@
+#include "MappedAsset.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base_utils.h"
+
+std::shared_ptr<MappedAsset> MappedAsset::fromAsset(AAssetManager *assetManager, const char *fileName) {
+    AAsset *asset = AAssetManager_open(assetManager, fileName, AASSET_MODE_BUFFER);
+    if (asset == nullptr) {
+        throw std::runtime_error("MappedAsset: asset does not exist: " + std::string(fileName));
+    }
+
+    std::shared_ptr<MappedAsset> mapped(new MappedAsset(fileName));
+    mapped->asset = asset;
+    mapped->length = AAsset_getLength64(asset);
+    mapped->bytes = static_cast<const char *>(AAsset_getBuffer(asset));
+    if (mapped->bytes == nullptr) {
+        throw std::runtime_error("MappedAsset: failed to map asset: " + std::string(fileName));
+    }
+
+    // AAsset_isAllocated is true when the NDK had to inflate a compressed entry into the heap
+    LOGD("Mapped asset %s (%zu bytes, %s)", fileName, mapped->length,
+         AAsset_isAllocated(asset) ? "inflated" : "zero-copy");
+    return mapped;
+}
+
+std::shared_ptr<MappedAsset> MappedAsset::fromFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("MappedAsset: mmap failed for " + path);
+    }
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+    std::shared_ptr<MappedAsset> mapped(new MappedAsset(path));
+    mapped->mapping = mapping;
+    mapped->length = st.st_size;
+    mapped->bytes = static_cast<const char *>(mapping);
+    LOGD("Mapped file %s (%zu bytes)", path.c_str(), mapped->length);
+    return mapped;
+}
+
+MappedAsset::~MappedAsset() {
+    if (asset != nullptr) {
+        AAsset_close(asset);
+    }
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+    }
+}
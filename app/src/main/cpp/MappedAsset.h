@@ -0,0 +1,50 @@
+#ifndef MAPPEDASSET_H
+#define MAPPEDASSET_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <android/asset_manager.h>
+
+// Read-only view over a scene file that is mapped once and never copied.
+// APK assets are opened with AASSET_MODE_BUFFER, which maps uncompressed entries
+// straight out of the APK (compressed entries are inflated once by the NDK).
+// Regular files (e.g. the app's cache directory) are mmap'd directly.
+class MappedAsset {
+public:
+    static std::shared_ptr<MappedAsset> fromAsset(AAssetManager * assetManager, const char * fileName);
+
+    static std::shared_ptr<MappedAsset> fromFile(const std::string & path);
+
+    MappedAsset(const MappedAsset &) = delete;
+
+    MappedAsset(MappedAsset &&) = delete;
+
+    MappedAsset &operator=(const MappedAsset &) = delete;
+
+    MappedAsset &operator=(MappedAsset &&) = delete;
+
+    ~MappedAsset();
+
+    const char * data() const { return bytes; }
+
+    size_t size() const { return length; }
+
+    std::string_view view() const { return {bytes, length}; }
+
+    const std::string & getName() const { return name; }
+
+private:
+    explicit MappedAsset(std::string name) : name(std::move(name)) {}
+
+    std::string name;
+    const char * bytes = nullptr;
+    size_t length = 0;
+
+    // exactly one of these owns the bytes
+    AAsset * asset = nullptr;
+    void * mapping = nullptr;
+};
+
+#endif //MAPPEDASSET_H
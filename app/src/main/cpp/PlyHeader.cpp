@@ -0,0 +1,255 @@
+#include "PlyHeader.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "base_utils.h"
+
+namespace {
+
+PlyType parsePlyType(const std::string &type) {
+    if (type == "char" || type == "int8") return PlyType::INT8;
+    if (type == "uchar" || type == "uint8") return PlyType::UINT8;
+    if (type == "short" || type == "int16") return PlyType::INT16;
+    if (type == "ushort" || type == "uint16") return PlyType::UINT16;
+    if (type == "int" || type == "int32") return PlyType::INT32;
+    if (type == "uint" || type == "uint32") return PlyType::UINT32;
+    // not part of the original PLY spec, but written by several splat exporters
+    if (type == "half" || type == "float16") return PlyType::FLOAT16;
+    if (type == "float" || type == "float32") return PlyType::FLOAT32;
+    if (type == "double" || type == "float64") return PlyType::FLOAT64;
+    throw std::runtime_error("PLY: unknown property type " + type);
+}
+
+const char *plyTypeName(PlyType type) {
+    switch (type) {
+        case PlyType::FLOAT16:
+            return "half";
+        case PlyType::FLOAT32:
+            return "float";
+        case PlyType::FLOAT64:
+            return "double";
+        default:
+            return "integer";
+    }
+}
+
+} // namespace
+
+size_t plyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::INT8:
+        case PlyType::UINT8:
+            return 1;
+        case PlyType::INT16:
+        case PlyType::UINT16:
+        case PlyType::FLOAT16:
+            return 2;
+        case PlyType::INT32:
+        case PlyType::UINT32:
+        case PlyType::FLOAT32:
+            return 4;
+        case PlyType::FLOAT64:
+            return 8;
+    }
+    return 0;
+}
+
+PlyHeader PlyHeader::parse(std::string_view content) {
+    PlyHeader header;
+    bool headerEnd = false;
+    size_t lineStart = 0;
+    while (lineStart < content.size()) {
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            break;
+        }
+        // header lines are short, so tokenizing a copy of each one is cheap
+        std::istringstream iss(std::string(content.substr(lineStart, lineEnd - lineStart)));
+        lineStart = lineEnd + 1;
+        std::string token;
+
+        iss >> token;
+
+        if (token == "format") {
+            iss >> header.format;
+        }
+        else if (token == "element") {
+            PlyElement element;
+            iss >> element.name >> element.count;
+            header.elements.push_back(element);
+        }
+        else if (token == "property") {
+            if (header.elements.empty()) {
+                throw std::runtime_error("PLY: property declared before any element");
+            }
+            PlyProperty property;
+            iss >> property.type;
+            if (property.type == "list") {
+                // list <count type> <item type> <name>, the record size depends on the data
+                std::string countType, itemType;
+                iss >> countType >> itemType;
+                property.isList = true;
+                property.scalarType = parsePlyType(itemType);
+            } else {
+                property.scalarType = parsePlyType(property.type);
+            }
+            iss >> property.name;
+            header.elements.back().properties.push_back(property);
+        }
+        else if (token == "end_header") {
+            headerEnd = true;
+            break;
+        }
+        // "ply", "comment" and "obj_info" lines carry nothing we need
+    }
+
+    if (!headerEnd) {
+        throw std::runtime_error("Could not find end of header");
+    }
+    header.bodyOffset = lineStart;
+
+    if (header.format != "binary_little_endian") {
+        throw std::runtime_error("PLY: unsupported format " + header.format + ", expected binary_little_endian");
+    }
+
+    // lay out each element; the vertex records start after every element declared before them
+    size_t elementOffset = header.bodyOffset;
+    bool vertexFound = false;
+    for (auto &element: header.elements) {
+        size_t offset = 0;
+        bool variableSize = false;
+        for (auto &property: element.properties) {
+            property.offset = offset;
+            if (property.isList) {
+                variableSize = true;
+            } else {
+                offset += plyTypeSize(property.scalarType);
+            }
+        }
+        element.stride = variableSize ? 0 : offset;
+
+        if (element.name == "vertex") {
+            if (element.stride == 0) {
+                throw std::runtime_error("PLY: vertex element has list properties");
+            }
+            header.numVertices = element.count;
+            header.vertexProperties = element.properties;
+            header.vertexStride = element.stride;
+            header.vertexOffset = elementOffset;
+            vertexFound = true;
+        } else if (element.name == "face") {
+            header.numFaces = element.count;
+            header.faceProperties = element.properties;
+        }
+
+        if (!vertexFound) {
+            if (element.stride == 0) {
+                throw std::runtime_error("PLY: variable-size element " + element.name + " precedes the vertices");
+            }
+            elementOffset += element.stride * element.count;
+        }
+    }
+
+    if (!vertexFound) {
+        throw std::runtime_error("PLY: no vertex element");
+    }
+    return header;
+}
+
+const PlyProperty *PlyHeader::findVertexProperty(std::string_view name) const {
+    for (const auto &property: vertexProperties) {
+        if (property.name == name) {
+            return &property;
+        }
+    }
+    return nullptr;
+}
+
+PlyVertexLayout PlyVertexLayout::fromHeader(const PlyHeader &header) {
+    PlyVertexLayout layout;
+    layout.stride = header.vertexStride;
+
+    size_t numUsed = 0;
+    bool typeSet = false;
+    auto require = [&](const std::string &name) {
+        const PlyProperty *property = header.findVertexProperty(name);
+        if (property == nullptr) {
+            throw std::runtime_error("PLY: missing vertex property " + name);
+        }
+        if (property->scalarType != PlyType::FLOAT32 && property->scalarType != PlyType::FLOAT16) {
+            throw std::runtime_error("PLY: vertex property " + name + " must be float or half");
+        }
+        if (!typeSet) {
+            layout.attributeType = property->scalarType;
+            typeSet = true;
+        } else if (property->scalarType != layout.attributeType) {
+            throw std::runtime_error("PLY: vertex property " + name + " mixes float and half attributes");
+        }
+        numUsed++;
+        return property->offset;
+    };
+
+    const char *axes[3] = {"x", "y", "z"};
+    for (int i = 0; i < 3; i++) {
+        layout.position[i] = require(axes[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        layout.scale[i] = require("scale_" + std::to_string(i));
+    }
+    layout.opacity = require("opacity");
+    for (int i = 0; i < 4; i++) {
+        layout.rotation[i] = require("rot_" + std::to_string(i));
+    }
+
+    size_t attributeSize = plyTypeSize(layout.attributeType);
+
+    // the converters read SH coefficients as one contiguous run, so check they really are
+    layout.shDc = require("f_dc_0");
+    for (int i = 1; i < 3; i++) {
+        if (require("f_dc_" + std::to_string(i)) != layout.shDc + i * attributeSize) {
+            throw std::runtime_error("PLY: f_dc_* properties are not contiguous");
+        }
+    }
+
+    int numRest = 0;
+    while (header.findVertexProperty("f_rest_" + std::to_string(numRest)) != nullptr) {
+        numRest++;
+    }
+    switch (numRest) {
+        case 0:
+            layout.shDegree = 0;
+            break;
+        case 9:
+            layout.shDegree = 1;
+            break;
+        case 24:
+            layout.shDegree = 2;
+            break;
+        case 45:
+            layout.shDegree = 3;
+            break;
+        default:
+            throw std::runtime_error("PLY: " + std::to_string(numRest) + " f_rest_* properties do not match an SH degree");
+    }
+    if (numRest > 0) {
+        layout.shRest = require("f_rest_0");
+        for (int i = 1; i < numRest; i++) {
+            if (require("f_rest_" + std::to_string(i)) != layout.shRest + i * attributeSize) {
+                throw std::runtime_error("PLY: f_rest_* properties are not contiguous");
+            }
+        }
+    }
+
+    layout.hasNormals = header.findVertexProperty("nx") != nullptr;
+    layout.numExtraProperties = header.vertexProperties.size() - numUsed;
+    return layout;
+}
+
+std::string PlyVertexLayout::describe() const {
+    std::ostringstream out;
+    out << plyTypeName(attributeType) << ", SH degree " << shDegree
+        << (hasNormals ? ", normals" : "") << ", " << numExtraProperties << " unused properties, "
+        << stride << " bytes per vertex";
+    return out.str();
+}
@@ -0,0 +1,84 @@
+#ifndef PLYHEADER_H
+#define PLYHEADER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class PlyType {
+    INT8,
+    UINT8,
+    INT16,
+    UINT16,
+    INT32,
+    UINT32,
+    FLOAT16,
+    FLOAT32,
+    FLOAT64,
+};
+
+size_t plyTypeSize(PlyType type);
+
+struct PlyProperty {
+    std::string type;
+    std::string name;
+    PlyType scalarType = PlyType::FLOAT32;
+    // byte offset inside one record of the owning element
+    size_t offset = 0;
+    bool isList = false;
+};
+
+struct PlyElement {
+    std::string name;
+    int count = 0;
+    std::vector<PlyProperty> properties;
+    // bytes per record, 0 if the element has list properties (variable size)
+    size_t stride = 0;
+};
+
+struct PlyHeader {
+    std::string format;
+    int numVertices = 0;
+    int numFaces = 0;
+    std::vector<PlyProperty> vertexProperties;
+    std::vector<PlyProperty> faceProperties;
+    std::vector<PlyElement> elements;
+    // first byte after "end_header\n"
+    size_t bodyOffset = 0;
+    // first byte of the vertex records, relative to the start of the file
+    size_t vertexOffset = 0;
+    size_t vertexStride = 0;
+
+    // Parses the ASCII header of a binary_little_endian PLY file, throws std::runtime_error on anything
+    // it cannot lay out exactly (other formats, unknown types, list properties before the vertices)
+    static PlyHeader parse(std::string_view content);
+
+    const PlyProperty * findVertexProperty(std::string_view name) const;
+};
+
+// Where every 3DGS attribute lives inside one vertex record. Built once per file from the header,
+// the converters in VertexConverter are specialized on attributeType and shDegree.
+struct PlyVertexLayout {
+    size_t stride = 0;
+    // FLOAT32 or FLOAT16, shared by all attributes the renderer reads
+    PlyType attributeType = PlyType::FLOAT32;
+    int shDegree = 0;
+    bool hasNormals = false;
+    // properties the renderer does not use (training attributes etc.), skipped by the stride
+    size_t numExtraProperties = 0;
+
+    size_t position[3] = {};
+    size_t scale[3] = {};
+    size_t opacity = 0;
+    size_t rotation[4] = {};
+    // f_dc_0..2 and f_rest_* are stored back to back, channel-major
+    size_t shDc = 0;
+    size_t shRest = 0;
+
+    static PlyVertexLayout fromHeader(const PlyHeader & header);
+
+    std::string describe() const;
+};
+
+#endif //PLYHEADER_H
@@ -0,0 +1,62 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "WorkerPool.h"
+
+namespace RadixSort {
+
+void sortPairs(std::vector<uint32_t> & keys, std::vector<uint32_t> & values, uint32_t keyBits) {
+    constexpr uint32_t DIGIT_BITS = 8;
+    constexpr size_t DIGITS = 1 << DIGIT_BITS;
+    constexpr size_t MIN_RANGE = 65536;
+    if (keys.size() != values.size()) {
+        throw std::runtime_error("RadixSort: keys and values differ in length");
+    }
+    size_t n = keys.size();
+    auto & pool = WorkerPool::shared();
+    size_t numRanges = std::max<size_t>(1, std::min(pool.concurrency(), n / MIN_RANGE));
+    size_t rangeSize = (n + numRanges - 1) / numRanges;
+
+    std::vector<uint32_t> keysOut(n);
+    std::vector<uint32_t> valuesOut(n);
+    // digit counts per range, turned into the scatter offsets of each range in place
+    std::vector<size_t> offsets(numRanges * DIGITS);
+    for (uint32_t shift = 0; shift < keyBits; shift += DIGIT_BITS) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        pool.parallelFor(numRanges, [&](size_t rangeBegin, size_t rangeEnd) {
+            for (size_t r = rangeBegin; r < rangeEnd; r++) {
+                size_t * counts = &offsets[r * DIGITS];
+                for (size_t i = r * rangeSize; i < std::min(n, (r + 1) * rangeSize); i++) {
+                    counts[(keys[i] >> shift) & (DIGITS - 1)]++;
+                }
+            }
+        }, 1);
+
+        // digit-major, range-minor: range r places its items of a digit after those of ranges < r
+        size_t sum = 0;
+        for (size_t digit = 0; digit < DIGITS; digit++) {
+            for (size_t r = 0; r < numRanges; r++) {
+                size_t count = offsets[r * DIGITS + digit];
+                offsets[r * DIGITS + digit] = sum;
+                sum += count;
+            }
+        }
+
+        pool.parallelFor(numRanges, [&](size_t rangeBegin, size_t rangeEnd) {
+            for (size_t r = rangeBegin; r < rangeEnd; r++) {
+                size_t * next = &offsets[r * DIGITS];
+                for (size_t i = r * rangeSize; i < std::min(n, (r + 1) * rangeSize); i++) {
+                    size_t position = next[(keys[i] >> shift) & (DIGITS - 1)]++;
+                    keysOut[position] = keys[i];
+                    valuesOut[position] = values[i];
+                }
+            }
+        }, 1);
+        keys.swap(keysOut);
+        values.swap(valuesOut);
+    }
+}
+
+} // namespace RadixSort
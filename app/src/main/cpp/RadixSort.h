@@ -0,0 +1,14 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <cstdint>
+#include <vector>
+
+// Parallel LSD radix sort on WorkerPool::shared(), 8 bits per pass. Every pass histograms fixed index ranges and
+// scatters them in range order, so the sort is stable and its result does not depend on the thread count.
+namespace RadixSort {
+    // Sorts keys ascending and moves values along; only the low keyBits bits of the keys are compared
+    void sortPairs(std::vector<uint32_t> & keys, std::vector<uint32_t> & values, uint32_t keyBits = 32);
+}
+
+#endif //RADIXSORT_H
@@ -4,6 +4,7 @@
 
 #include "vulkan/Swapchain.h"
 
+#include <cstddef>
 #include <memory>
 #include "shaders.h"
 #include <utility>
@@ -135,11 +136,11 @@ void Renderer::handleInput() {
 }
 
 void Renderer::moveCameraForProfiling() {
-    if(profilingMode == FPS){
+    if(profilingMode == FPS || profilingMode == ORDER || profilingMode == EXTENTS){
         camera.rotation = glm::rotate(camera.rotation, static_cast<float>(1) * 0.005f,
                                       glm::vec3(0.0f, 1.0f, 0.0f));
     }
-    if(profilingMode == PSNR){
+    if(profilingMode == PSNR && !trajectory.empty()){
 //        glm::quat rot_quat = camera.rotation;
 //        LOGO("QUATERNION: %f, %f, %f, %f", rot_quat[0], rot_quat[1], rot_quat[2], rot_quat[3]);
 //
@@ -147,24 +148,24 @@ void Renderer::moveCameraForProfiling() {
 //        LOGO("TRANSLATION: %f, %f, %f", translation[0], translation[1], translation[2]);
 
         // read from camera pose array
+        applyProfilingPose(cameraPosIndex);
 
-        // change camera rotation
-        glm::mat3x3 rotation = rotations[cameraPosIndex];
-        glm::quat rot_quat = glm::quat_cast(rotation);
-
-        LOGO("QUATERNION: %f, %f, %f, %f", rot_quat[0], rot_quat[1], rot_quat[2], rot_quat[3]);
-        camera.rotation = rot_quat;
-
-        glm::vec3 translation = (-glm::transpose(rotation)) * translations[cameraPosIndex];
-        LOGO("TRANSLATION: %f, %f, %f", translation[0], translation[1], translation[2]);
-
-        camera.position = glm::vec3(static_cast<float>(translation[0]), static_cast<float>(translation[1]), static_cast<float>(translation[2]));
+        cameraPosIndex = (cameraPosIndex + 1) % trajectory.size();
+    }
+}
 
-        cameraPosIndex = (cameraPosIndex + 1) % rotations.size();
+void Renderer::applyProfilingPose(size_t index) {
+    const CameraPose & pose = trajectory[index];
+    camera.rotation = pose.rotation;
+    camera.position = pose.position;
+    if (pose.fovX > 0.0f) {
+        camera.fov = glm::degrees(pose.fovX);
     }
+    LOGD("POSE %zu: quaternion %f, %f, %f, %f, position %f, %f, %f", index, pose.rotation.w, pose.rotation.x,
+         pose.rotation.y, pose.rotation.z, pose.position.x, pose.position.y, pose.position.z);
 }
 
-void Renderer::retrieveTimestamps() {
+std::unordered_map<std::string, uint64_t> Renderer::retrieveTimestamps() {
     std::vector<uint64_t> timestamps(queryManager->nextId);
     auto res = context->device->getQueryPoolResults(context->queryPool.get(), 0, queryManager->nextId,
                                                     timestamps.size() * sizeof(uint64_t),
@@ -180,6 +181,161 @@ void Renderer::retrieveTimestamps() {
         if (configuration.enableGui)
             guiManager.pushMetric(metric.first, metric.second / 1000000.0);
     }
+    return metrics;
+}
+
+// ProfilingMode::ORDER: renders every scene of scenePaths in file order and in Morton order along the FPS profiling
+// rotation and logs the mean GPU time of the passes that read splats by index
+void Renderer::runOrderBenchmark() {
+    constexpr int WARMUP_FRAMES = 30;
+    constexpr int MEASURED_FRAMES = 300;
+    const std::array<std::string, 3> passes = {"preprocess", "preprocess_sort", "render"};
+    if (!showMetrics) {
+        LOGO("Splat order benchmark needs the timestamp queries of showMetrics");
+        return;
+    }
+
+    LOGO("Splat order benchmark, mean GPU ms over %d frames", MEASURED_FRAMES);
+    LOGO("%-20s %-8s %12s %16s %10s", "scene", "order", "preprocess", "preprocess_sort", "render");
+    for (size_t index = 0; index < configuration.scenePaths.size() && running; index++) {
+        const auto& path = configuration.scenePaths[index];
+        for (auto order: {SplatOrder::FILE_ORDER, SplatOrder::MORTON}) {
+            auto options = getLoadOptions();
+            options.order = order;
+            options.progressive = false;
+            options.residencyBudget = 0;
+            auto next = std::make_shared<GSScene>(MappedAsset::fromAsset(assetManager, path.c_str()), options);
+            next->load(context);
+            pendingScenePathIndex = static_cast<int>(index);
+            swapScene(std::move(next));
+
+            std::array<double, 3> sums{};
+            int measured = 0;
+            for (int frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES && running && window->tick(); frame++) {
+                draw();
+                auto metrics = retrieveTimestamps();
+                if (frame < WARMUP_FRAMES) {
+                    continue;
+                }
+                for (size_t pass = 0; pass < passes.size(); pass++) {
+                    sums[pass] += metrics[passes[pass]] / 1000000.0;
+                }
+                measured++;
+            }
+            measured = std::max(measured, 1);
+            LOGO("%-20s %-8s %12.3f %16.3f %10.3f", path.c_str(), order == SplatOrder::MORTON ? "morton" : "file",
+                 sums[0] / measured, sums[1] / measured, sums[2] / measured);
+        }
+    }
+}
+
+// ProfilingMode::PRUNE: renders the current scene without and with LoadOptions::pruning from every pose of
+// the profiling trajectory and logs what pruning removed next to the PSNR of the pruned frames against the unpruned ones
+void Renderer::runPruneReport() {
+    if (trajectory.empty() || configuration.scenePaths.empty()) {
+        LOGO("Pruning report needs a profiling trajectory and a scene path");
+        return;
+    }
+    const auto& path = configuration.scenePaths[scenePathIndex];
+    std::vector<std::vector<float>> reference;
+    double psnrSum = 0.0;
+    size_t compared = 0;
+    GSScene::LoadStats prunedStats;
+    for (bool pruned: {false, true}) {
+        auto options = getLoadOptions();
+        if (!pruned) {
+            options.pruning = PruneOptions{};
+        }
+        // a cached scene does not know what was pruned from it
+        options.cacheDir.clear();
+        options.progressive = false;
+        options.residencyBudget = 0;
+        auto next = std::make_shared<GSScene>(MappedAsset::fromAsset(assetManager, path.c_str()), options);
+        next->load(context);
+        prunedStats = next->getLoadStats();
+        pendingScenePathIndex = scenePathIndex;
+        swapScene(std::move(next));
+
+        for (size_t pose = 0; pose < trajectory.size() && running && window->tick(); pose++) {
+            applyProfilingPose(pose);
+            draw();
+            auto image = retrieveRenderedImage();
+            if (!pruned) {
+                reference.push_back(std::move(image));
+            } else if (pose < reference.size()) {
+                psnrSum += computePSNR(image, reference[pose], 1.0f);
+                compared++;
+            }
+        }
+    }
+
+    LOGO("Pruning report for %s: %zu of %llu splats removed, %.1f MB saved", path.c_str(), prunedStats.prunedSplats,
+         static_cast<unsigned long long>(scene->getSceneVertices() + prunedStats.prunedSplats),
+         prunedStats.prunedBytes / (1024.0 * 1024.0));
+    if (compared > 0) {
+        LOGO("PSNR of the pruned scene against the unpruned one: %.2f dB over %zu poses", psnrSum / compared, compared);
+    }
+}
+
+// ProfilingMode::EXTENTS: renders every scene of scenePaths with the 3 sigma square and with the opacity-aware tile
+// extents along the FPS profiling rotation and logs the mean instance count and GPU time of the passes it sizes
+void Renderer::runExtentReport() {
+    constexpr int WARMUP_FRAMES = 30;
+    constexpr int MEASURED_FRAMES = 300;
+    const std::array<std::string, 4> passes = {"preprocess_sort", "sort", "tile_boundary", "render"};
+    if (!showMetrics) {
+        LOGO("Extent report needs the timestamp queries of showMetrics");
+        return;
+    }
+
+    LOGO("Splat extent report, means over %d frames, GPU ms", MEASURED_FRAMES);
+    LOGO("%-20s %-8s %12s %16s %8s %14s %8s", "scene", "extents", "instances", "preprocess_sort", "sort",
+         "tile_boundary", "render");
+    for (size_t index = 0; index < configuration.scenePaths.size() && running; index++) {
+        const auto& path = configuration.scenePaths[index];
+        auto options = getLoadOptions();
+        options.progressive = false;
+        options.residencyBudget = 0;
+        auto next = std::make_shared<GSScene>(MappedAsset::fromAsset(assetManager, path.c_str()), options);
+        next->load(context);
+        pendingScenePathIndex = static_cast<int>(index);
+        swapScene(std::move(next));
+
+        for (bool tight: {false, true}) {
+            tightExtents = tight;
+            preprocessPipeline = getPreprocessPipeline(scene->getShDegree());
+            recordPreprocessCommandBuffer();
+            // both variants fly the same path
+            camera = initialCameraPoses[index % initialCameraPoses.size()];
+
+            double instances = 0.0;
+            std::array<double, 4> sums{};
+            int measured = 0;
+            for (int frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES && running && window->tick(); frame++) {
+                draw();
+                auto metrics = retrieveTimestamps();
+                if (frame < WARMUP_FRAMES) {
+                    continue;
+                }
+                auto ret = context->device->waitForFences(inflightFences[0].get(), VK_TRUE, UINT64_MAX);
+                if (ret != vk::Result::eSuccess) {
+                    throw std::runtime_error("Failed to wait for fence");
+                }
+                instances += totalSumBufferHost->readOne<uint32_t>(sizeof(uint32_t));
+                for (size_t pass = 0; pass < passes.size(); pass++) {
+                    sums[pass] += metrics[passes[pass]] / 1000000.0;
+                }
+                measured++;
+            }
+            measured = std::max(measured, 1);
+            LOGO("%-20s %-8s %12.0f %16.3f %8.3f %14.3f %8.3f", path.c_str(), tight ? "tight" : "square",
+                 instances / measured, sums[0] / measured, sums[1] / measured, sums[2] / measured,
+                 sums[3] / measured);
+        }
+    }
+    tightExtents = configuration.tightExtents;
+    preprocessPipeline = getPreprocessPipeline(scene->getShDegree());
+    recordPreprocessCommandBuffer();
 }
 
 void Renderer::recreateSwapchain() {
@@ -230,6 +386,20 @@ void Renderer::initializeVulkan() {
     // I added this
      pdf12.shaderFloat16 = true;
 
+    if (configuration.splatStorage == SplatStorage::HALF) {
+        // 16-bit members in storage buffers are a separate feature from shaderFloat16
+        vk::PhysicalDeviceVulkan11Features supported11{};
+        vk::PhysicalDeviceFeatures2 supported{};
+        supported.pNext = &supported11;
+        context->physicalDevice.getFeatures2(&supported);
+        if (supported11.storageBuffer16BitAccess) {
+            pdf11.storageBuffer16BitAccess = true;
+        } else {
+            LOGO("storageBuffer16BitAccess is not supported, falling back to fp32 splats");
+            configuration.splatStorage = SplatStorage::FLOAT32;
+        }
+    }
+
     // This is a Vulkan 1.2 feature that isn't available on our physical device. I don't think we can enable it
     // can we replace this with the Int16 feature that we do have access to?
 
@@ -256,51 +426,317 @@ void Renderer::initializeVulkan() {
 
 void Renderer::loadSceneToGPU() {
     LOGD("Loading scene to GPU");
-    scene = std::make_shared<GSScene>(configuration.assetContent);
-    scene->load(context);
+    startSceneLoad([asset = configuration.sceneAsset]() { return asset; }, scenePathIndex);
+    configuration.sceneAsset.reset();
+
+    // a progressive load starts rendering after its first batch, the rest is picked up by pollSceneLoad
+    while (!(scene = takeDrawableScene())) {
+        if (sceneLoad.wait_for(std::chrono::milliseconds(1)) == std::future_status::ready) {
+            sceneLoad.get();
+            std::lock_guard<std::mutex> lock(pendingSceneMutex);
+            scene = std::move(pendingScene);
+            pushLoadMetrics();
+            break;
+        }
+    }
+    cacheScene();
+}
+
+void Renderer::pushLoadMetrics() {
+    auto& stats = scene->getLoadStats();
+    guiManager.pushTextMetric("load time (ms)", stats.loadMs);
+    guiManager.pushTextMetric("first drawable batch (ms)", stats.firstBatchMs);
+    guiManager.pushTextMetric("vertex conversion (ms)", stats.convertMs);
+    if (stats.gpuDecodeMs > 0.0) {
+        guiManager.pushTextMetric("GPU decode (ms)", stats.gpuDecodeMs);
+    }
+    guiManager.pushTextMetric("loaded from scene cache", stats.fromCache ? 1.0f : 0.0f);
+    guiManager.pushTextMetric("load peak RSS (MB)", stats.peakRssKb / 1024.0f);
+    guiManager.pushTextMetric("load staging (MB)", stats.stagingBytes / (1024.0f * 1024.0f));
+    guiManager.pushTextMetric("import working set (MB)", stats.importWorkingBytes / (1024.0f * 1024.0f));
+    guiManager.pushTextMetric("bytes per splat",
+                              static_cast<float>(scene->getDeviceBytes()) / std::max<uint64_t>(scene->getNumVertices(), 1));
+    guiManager.pushTextMetric("SH degree", static_cast<float>(scene->getShDegree()));
+    if (scene->getStorage() != SplatStorage::FLOAT32 || scene->getShDegree() < 3) {
+        guiManager.pushTextMetric("SH color PSNR (dB)", static_cast<float>(stats.storagePsnr));
+    }
+    if (stats.prunedSplats > 0) {
+        guiManager.pushTextMetric("pruned splats", static_cast<float>(stats.prunedSplats));
+        guiManager.pushTextMetric("pruning saved (MB)", stats.prunedBytes / (1024.0f * 1024.0f));
+    }
+}
+
+GSScene::LoadOptions Renderer::getLoadOptions() const {
+    return GSScene::LoadOptions{configuration.cacheDir, configuration.stagingBudget, configuration.splatStorage,
+                                configuration.maxShDegree, configuration.progressiveLoad,
+                                configuration.residencyBudget, configuration.splatOrder, configuration.pruning,
+                                configuration.gpuDecode};
+}
+
+void Renderer::startSceneLoad(std::function<std::shared_ptr<MappedAsset>()> openAsset, int index) {
+    pendingScenePathIndex = index;
+
+    // the loader only touches its own GSScene, the TRANSFER queue and the locked descriptor pool. The scene is
+    // published before load() so the render thread can pick it up as soon as its first batch is resident.
+    auto options = getLoadOptions();
+    sceneLoad = std::async(std::launch::async, [this, context = context, openAsset = std::move(openAsset), options]() {
+        auto next = std::make_shared<GSScene>(openAsset(), options);
+        {
+            std::lock_guard<std::mutex> lock(pendingSceneMutex);
+            pendingScene = next;
+        }
+        next->load(context);
+    });
+}
+
+std::shared_ptr<GSScene> Renderer::takeDrawableScene() {
+    std::lock_guard<std::mutex> lock(pendingSceneMutex);
+    if (pendingScene && pendingScene->getResidentVertices() > 0) {
+        return std::move(pendingScene);
+    }
+    return nullptr;
+}
+
+// Called at every frame boundary: swaps in a scene once it is drawable and reports the load once it is done.
+void Renderer::pollSceneLoad() {
+    if (auto next = takeDrawableScene()) {
+        swapScene(std::move(next));
+        // a scene still loading is cached as well, its buffers are complete and the load keeps filling them
+        cacheScene();
+    }
+    if (!sceneLoad.valid()) {
+        return;
+    }
+    if (sceneLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        guiManager.pushTextMetric("resident splats (%)",
+                                  100.0f * scene->getResidentVertices() / std::max<uint64_t>(scene->getNumVertices(), 1));
+        return;
+    }
+    try {
+        sceneLoad.get();
+        pushLoadMetrics();
+    } catch (const std::exception& e) {
+        // a scene that failed mid-stream keeps drawing the batches it got
+        LOGO("Background scene load failed, keeping the current scene: %s", e.what());
+        if (pendingScenePathIndex < static_cast<int>(configuration.scenePaths.size())) {
+            // the next visit loads it again
+            gpuScenes.erase(configuration.scenePaths[pendingScenePathIndex]);
+        }
+        std::lock_guard<std::mutex> lock(pendingSceneMutex);
+        pendingScene.reset();
+    }
+}
+
+void Renderer::swapScene(std::shared_ptr<GSScene> next) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // the frame in flight still reads the buffers of the old scene
+    auto ret = context->device->waitForFences(inflightFences[0].get(), VK_TRUE, UINT64_MAX);
+    if (ret != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for fence");
+    }
+
+    scene = std::move(next);
+    scenePathIndex = pendingScenePathIndex;
+    camera = initialCameraPoses[scenePathIndex % initialCameraPoses.size()];
+    bindScene();
+
+    float stallMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    LOGD("Swapped scenes, render thread stalled for %.2f ms", stallMs);
+    guiManager.pushTextMetric("scene switch stall (ms)", stallMs);
+}
+
+void Renderer::cacheScene() {
+    if (scenePathIndex < static_cast<int>(configuration.scenePaths.size())) {
+        gpuScenes.insert(configuration.scenePaths[scenePathIndex], scene);
+        pushSceneCacheMetrics();
+    }
+}
+
+void Renderer::pushSceneCacheMetrics() {
+    guiManager.pushTextMetric("cached scenes", static_cast<float>(gpuScenes.getSceneCount()));
+    guiManager.pushTextMetric("scene cache (MB)", gpuScenes.getResidentBytes() / (1024.0f * 1024.0f));
+    guiManager.pushTextMetric("scene cache hits", static_cast<float>(gpuScenes.getHits()));
+}
+
+void Renderer::bindScene() {
+    // pipelines, layouts and the swapchain-sized buffers stay, only the splat-count-sized buffers follow the scene
+    auto resize = [](const std::shared_ptr<Buffer>& buffer, vk::DeviceSize size) {
+        if (buffer->size != size) {
+            buffer->realloc(size);
+        }
+    };
+    auto numVertices = static_cast<vk::DeviceSize>(scene->getNumVertices());
+    sortBufferSizeMultiplier = 1;
+    resize(vertexAttributeBuffer, numVertices * sizeof(VertexAttributeBuffer));
+    resize(prefixSumPingBuffer, numVertices * sizeof(uint32_t));
+    resize(prefixSumPongBuffer, numVertices * sizeof(uint32_t));
+    resize(sortKBufferEven, numVertices * sizeof(uint32_t));
+    resize(sortKBufferOdd, numVertices * sizeof(uint32_t));
+    resize(sortVBufferEven, numVertices * sizeof(uint32_t));
+    resize(sortVBufferOdd, numVertices * sizeof(uint32_t));
+    resize(sortHistBuffer, getSortHistSize());
+    resize(slotTableBuffer, getSlotTableSize());
+    resize(colorCacheBuffer, getColorCacheSize());
+    clearColorCache();
+    // the counts of the old scene would size the sort buffers of the first frame
+    uint32_t noCounts[3] = {};
+    totalSumBufferHost->upload(noCounts, sizeof(noCounts));
+
+    inputSet->updateBuffer(0, scene->vertexBuffer);
+    inputSet->updateBuffer(1, scene->cov3DBuffer);
+    if (scene->storageDataBuffer) {
+        inputSet->updateBuffer(2, scene->storageDataBuffer);
+    }
+    preprocessPipeline = getPreprocessPipeline(scene->getShDegree());
+
+    recordPreprocessCommandBuffer();
+}
+
+vk::DeviceSize Renderer::getSortHistSize() const {
+    uint32_t globalInvocationSize = scene->getNumVertices() * sortBufferSizeMultiplier / numRadixSortBlocksPerWorkgroup;
+    uint32_t remainder = scene->getNumVertices() * sortBufferSizeMultiplier % numRadixSortBlocksPerWorkgroup;
+    globalInvocationSize += remainder > 0 ? 1 : 0;
+
+    auto numWorkgroups = (globalInvocationSize + 256 - 1) / 256;
+    return numWorkgroups * 256 * sizeof(uint32_t);
+}
 
-    // reset descriptor pool
-    context->device->resetDescriptorPool(context->descriptorPool.get());
+uint32_t Renderer::getSortCapacity() const {
+    return scene->getNumVertices() * sortBufferSizeMultiplier;
+}
+
+void Renderer::growSortBuffers(uint32_t numInstances) {
+    auto old = sortBufferSizeMultiplier;
+    while (numInstances > getSortCapacity()) {
+        sortBufferSizeMultiplier++;
+    }
+    LOGD("Reallocating sort buffers. %i -> %i", old, sortBufferSizeMultiplier);
+    sortKBufferEven->realloc(getSortCapacity() * sizeof(uint32_t));
+    sortKBufferOdd->realloc(getSortCapacity() * sizeof(uint32_t));
+    sortVBufferEven->realloc(getSortCapacity() * sizeof(uint32_t));
+    sortVBufferOdd->realloc(getSortCapacity() * sizeof(uint32_t));
+
+    sortHistBuffer->realloc(getSortHistSize());
+
+    // the capacity is a push constant of sort_dispatch
+    recordPreprocessCommandBuffer();
+}
+
+vk::DeviceSize Renderer::getSlotTableSize() const {
+    auto residency = scene->getResidency();
+    return (residency ? residency->getSlotCount() : 1) * sizeof(uint32_t);
+}
+
+vk::DeviceSize Renderer::getColorCacheSize() const {
+    // one vec3 color and one packed direction
+    constexpr vk::DeviceSize entrySize = 16;
+    bool enabled = configuration.colorCacheTolerance > 0.0f && !scene->getResidency() && scene->getShDegree() > 0;
+    return (enabled ? scene->getNumVertices() : 1) * entrySize;
+}
+
+void Renderer::clearColorCache() {
+    // COLOR_CACHE_EMPTY in every word, no direction matches it
+    auto commandBuffer = context->beginOneTimeCommandBuffer(VulkanContext::Queue::COMPUTE);
+    commandBuffer->fillBuffer(colorCacheBuffer->buffer, 0, VK_WHOLE_SIZE, 0x80008000u);
+    context->endOneTimeCommandBuffer(std::move(commandBuffer), VulkanContext::Queue::COMPUTE);
 }
 
 void Renderer::createPreprocessPipeline() {
     LOGD("Creating preprocess pipeline");
     uniformBuffer = Buffer::uniform(context, sizeof(UniformBuffer));
+    slotTableBuffer = std::make_shared<Buffer>(context, getSlotTableSize(), vk::BufferUsageFlagBits::eStorageBuffer,
+                                               VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
     vertexAttributeBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(VertexAttributeBuffer), false);
-    tileOverlapBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
+    // preprocess writes the tile counts of the visible splats straight into the scan input
+    prefixSumPingBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
+    prefixSumPongBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
+    visibleSplatsBuffer = std::make_shared<Buffer>(context, sizeof(VisibleSplats),
+                                                   vk::BufferUsageFlagBits::eStorageBuffer |
+                                                   vk::BufferUsageFlagBits::eIndirectBuffer |
+                                                   vk::BufferUsageFlagBits::eTransferDst |
+                                                   vk::BufferUsageFlagBits::eTransferSrc,
+                                                   VMA_MEMORY_USAGE_GPU_ONLY, 0, false, 0, "visibleSplatsBuffer");
+    colorCacheBuffer = Buffer::storage(context, getColorCacheSize(), false, 0, "colorCacheBuffer");
+    clearColorCache();
 
-    preprocessPipeline = std::make_shared<ComputePipeline>(
-        context, std::make_shared<Shader>(context, "preprocess", SPV_PREPROCESS, SPV_PREPROCESS_len));
     inputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
     inputSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                         scene->vertexBuffer);
     inputSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                         scene->cov3DBuffer);
+    if (scene->storageDataBuffer) {
+        inputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                            scene->storageDataBuffer);
+    }
     inputSet->build();
-    preprocessPipeline->addDescriptorSet(0, inputSet);
-
-    auto uniformOutputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
-    uniformOutputSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eUniformBuffer,
-                                                vk::ShaderStageFlagBits::eCompute,
-                                                uniformBuffer);
-    uniformOutputSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer,
-                                                vk::ShaderStageFlagBits::eCompute,
-                                                vertexAttributeBuffer);
-    uniformOutputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer,
-                                                vk::ShaderStageFlagBits::eCompute,
-                                                tileOverlapBuffer);
-    uniformOutputSet->build();
-
-    preprocessPipeline->addDescriptorSet(1, uniformOutputSet);
-    preprocessPipeline->build();
+
+    preprocessOutputSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    preprocessOutputSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eUniformBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   uniformBuffer);
+    preprocessOutputSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   vertexAttributeBuffer);
+    preprocessOutputSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   prefixSumPingBuffer);
+    preprocessOutputSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   slotTableBuffer);
+    preprocessOutputSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   visibleSplatsBuffer);
+    preprocessOutputSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer,
+                                                   vk::ShaderStageFlagBits::eCompute,
+                                                   colorCacheBuffer);
+    preprocessOutputSet->build();
+
+    preprocessPipeline = getPreprocessPipeline(scene->getShDegree());
+}
+
+std::shared_ptr<ComputePipeline> Renderer::getPreprocessPipeline(uint32_t shDegree) {
+    // the splat layout is fixed for the session, the SH degree is a specialization constant and can differ per scene
+    auto& pipeline = preprocessPipelines.at(shDegree + (tightExtents ? 4 : 0));
+    if (pipeline) {
+        return pipeline;
+    }
+
+    std::shared_ptr<Shader> preprocessShader;
+    switch (configuration.splatStorage) {
+        case SplatStorage::COMPRESSED:
+            preprocessShader = std::make_shared<Shader>(context, "preprocess_compressed", SPV_PREPROCESS_COMPRESSED,
+                                                        SPV_PREPROCESS_COMPRESSED_len);
+            break;
+        case SplatStorage::SH_CODEBOOK:
+            preprocessShader = std::make_shared<Shader>(context, "preprocess_sh_codebook", SPV_PREPROCESS_SH_CODEBOOK,
+                                                        SPV_PREPROCESS_SH_CODEBOOK_len);
+            break;
+        case SplatStorage::HALF:
+            preprocessShader = std::make_shared<Shader>(context, "preprocess_half", SPV_PREPROCESS_HALF,
+                                                        SPV_PREPROCESS_HALF_len);
+            break;
+        default:
+            preprocessShader = std::make_shared<Shader>(context, "preprocess", SPV_PREPROCESS, SPV_PREPROCESS_len);
+    }
+    pipeline = std::make_shared<ComputePipeline>(context, preprocessShader);
+    pipeline->addSpecializationConstant(0, shDegree);
+    pipeline->addSpecializationConstant(1, tightExtents ? 1u : 0u);
+    pipeline->addDescriptorSet(0, inputSet);
+    pipeline->addDescriptorSet(1, preprocessOutputSet);
+    pipeline->build();
+    return pipeline;
 }
 
 Renderer::Renderer(VulkanSplatting::RendererConfiguration& configuration, int scene_path_index) {
     this->configuration = configuration;
     this->profilingMode = configuration.profilingMode;
-    this->rotations = configuration.rotations;
-    this->translations = configuration.translations;
+    this->trajectory = configuration.trajectory;
     this->assetManager = configuration.assetManager;
+    this->scenePathIndex = scene_path_index;
+    this->gpuScenes = GpuSceneCache(configuration.gpuSceneBudget);
+    this->tightExtents = configuration.tightExtents;
 
     LOGD("SCENE INDEX: %i", scene_path_index);
     this->camera = initialCameraPoses[scene_path_index];
@@ -322,9 +758,10 @@ void Renderer::createGui() {
 
 void Renderer::createPrefixSumPipeline() {
     LOGD("Creating prefix sum pipeline");
-    prefixSumPingBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
-    prefixSumPongBuffer = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t), false);
-    totalSumBufferHost = Buffer::staging(context, sizeof(uint32_t));
+    // visible splat count, instance total and SH evaluations of the last finished frame
+    totalSumBufferHost = Buffer::staging(context, sizeof(uint32_t) * 3);
+    uint32_t noCounts[3] = {};
+    totalSumBufferHost->upload(noCounts, sizeof(noCounts));
 
     prefixSumPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "prefix_sum", SPV_PREFIX_SUM, SPV_PREFIX_SUM_len));
@@ -333,10 +770,12 @@ void Renderer::createPrefixSumPipeline() {
                                              prefixSumPingBuffer);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              prefixSumPongBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
     descriptorSet->build();
 
     prefixSumPipeline->addDescriptorSet(0, descriptorSet);
-    prefixSumPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+    prefixSumPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) * 2);
     prefixSumPipeline->build();
 }
 
@@ -351,13 +790,7 @@ void Renderer::createRadixSortPipeline() {
     sortVBufferOdd = Buffer::storage(context, scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier,
                                      false, 0, "sortVBufferOdd");
 
-    uint32_t globalInvocationSize = scene->getNumVertices() * sortBufferSizeMultiplier / numRadixSortBlocksPerWorkgroup;
-    uint32_t remainder = scene->getNumVertices() * sortBufferSizeMultiplier % numRadixSortBlocksPerWorkgroup;
-    globalInvocationSize += remainder > 0 ? 1 : 0;
-
-    auto numWorkgroups = (globalInvocationSize + 256 - 1) / 256;
-
-    sortHistBuffer = Buffer::storage(context, numWorkgroups * 256 * sizeof(uint32_t), false);
+    sortHistBuffer = Buffer::storage(context, getSortHistSize(), false);
 
     sortHistPipeline = std::make_shared<ComputePipeline>(
         context, std::make_shared<Shader>(context, "hist", SPV_HIST, SPV_HIST_len));
@@ -373,6 +806,8 @@ void Renderer::createRadixSortPipeline() {
                                              sortKBufferOdd);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
     descriptorSet->build();
     sortHistPipeline->addDescriptorSet(0, descriptorSet);
     sortHistPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
@@ -397,10 +832,22 @@ void Renderer::createRadixSortPipeline() {
                                              sortVBufferEven);
     descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortHistBuffer);
+    descriptorSet->bindBufferToDescriptorSet(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
     descriptorSet->build();
     sortPipeline->addDescriptorSet(0, descriptorSet);
     sortPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(RadixSortPushConstants));
     sortPipeline->build();
+
+    sortDispatchPipeline = std::make_shared<ComputePipeline>(
+        context, std::make_shared<Shader>(context, "sort_dispatch", SPV_SORT_DISPATCH, SPV_SORT_DISPATCH_len));
+    descriptorSet = std::make_shared<DescriptorSet>(context, FRAMES_IN_FLIGHT);
+    descriptorSet->bindBufferToDescriptorSet(0, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
+    descriptorSet->build();
+    sortDispatchPipeline->addDescriptorSet(0, descriptorSet);
+    sortDispatchPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) * 2);
+    sortDispatchPipeline->build();
 }
 
 void Renderer::createPreprocessSortPipeline() {
@@ -419,6 +866,8 @@ void Renderer::createPreprocessSortPipeline() {
                                              sortKBufferEven);
     descriptorSet->bindBufferToDescriptorSet(3, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              sortVBufferEven);
+    descriptorSet->bindBufferToDescriptorSet(4, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
     descriptorSet->build();
 
     preprocessSortPipeline->addDescriptorSet(0, descriptorSet);
@@ -442,10 +891,11 @@ void Renderer::createTileBoundaryPipeline() {
     //                                          sortKBufferOdd);
     descriptorSet->bindBufferToDescriptorSet(1, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
                                              tileBoundaryBuffer);
+    descriptorSet->bindBufferToDescriptorSet(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute,
+                                             visibleSplatsBuffer);
     descriptorSet->build();
 
     tileBoundaryPipeline->addDescriptorSet(0, descriptorSet);
-    tileBoundaryPipeline->addPushConstant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
     tileBoundaryPipeline->build();
 }
 
@@ -512,10 +962,16 @@ void Renderer::draw() {
             // Log the 30-second average FPS
             LOGO("30-SECOND AVERAGE FPS: %.2f (%u frames)",
                  thirtySecondAvgFps, thirtySecondFrameCount);
+            // the camera only rotates in this mode, so all but the rolling refresh should hit the color cache
+            LOGO("30-SECOND SH EVALUATED: %.2f%% of visible splats (refresh period %u)",
+                 100.0 * thirtySecondShEvaluations / std::max<uint64_t>(thirtySecondVisibleSplats, 1),
+                 configuration.colorCacheRefreshPeriod);
 
             // Reset for next 30-second interval
             thirtySecondIntervalStart = now;
             thirtySecondFrameCount = 0;
+            thirtySecondVisibleSplats = 0;
+            thirtySecondShEvaluations = 0;
         }
     }
     
@@ -532,6 +988,22 @@ void Renderer::draw() {
     }
     context->device->resetFences(inflightFences[0].get());
 
+    // counts of the frame that just finished: a frame that outgrew the sort buffers drew the instances that fit,
+    // the buffers grow now that nothing is in flight and the next frame sorts all of them
+    uint32_t numVisible = totalSumBufferHost->readOne<uint32_t>();
+    uint32_t numInstances = totalSumBufferHost->readOne<uint32_t>(sizeof(uint32_t));
+    uint32_t numShEvaluations = totalSumBufferHost->readOne<uint32_t>(sizeof(uint32_t) * 2);
+    thirtySecondVisibleSplats += numVisible;
+    thirtySecondShEvaluations += numShEvaluations;
+//    LOGD("Num instances: %i, Num Vertices: %i", numInstances, scene->getNumVertices());
+    guiManager.pushTextMetric("visible splats", numVisible);
+    guiManager.pushTextMetric("SH evaluated (%)", 100.0f * numShEvaluations / std::max<uint32_t>(numVisible, 1));
+    guiManager.pushTextMetric("instances", numInstances);
+    guiManager.pushTextMetric("fps", realerFps);
+    if (numInstances > getSortCapacity()) {
+        growSortBuffers(numInstances);
+    }
+
     auto res = context->device->acquireNextImageKHR(swapchain->swapchain.get(), UINT64_MAX,
                                                     swapchain->imageAvailableSemaphores[0].get(),
                                                     nullptr, &currentImageIndex);
@@ -542,8 +1014,6 @@ void Renderer::draw() {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
 
-startOfRenderLoop:
-
 #ifdef DEBUG
     handleInput();
 #else
@@ -552,24 +1022,18 @@ startOfRenderLoop:
 
     updateUniforms();
 
-    auto submitInfo = vk::SubmitInfo{}.setCommandBuffers(preprocessCommandBuffer.get());
-    context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfo, inflightFences[0].get());
+    recordRenderCommandBuffer(0);
 
-    ret = context->device->waitForFences(inflightFences[0].get(), VK_TRUE, UINT64_MAX);
-    if (ret != vk::Result::eSuccess) {
-        throw std::runtime_error("Failed to wait for fence");
-    }
-    context->device->resetFences(inflightFences[0].get());
-
-    if (!recordRenderCommandBuffer(0)) {
-        goto startOfRenderLoop;
-    }
+    // one vkQueueSubmit and one fence per frame; only the second batch waits for the swapchain image
     vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader;
-    submitInfo = vk::SubmitInfo{}.setWaitSemaphores(swapchain->imageAvailableSemaphores[0].get())
-            .setCommandBuffers(renderCommandBuffer.get())
-            .setSignalSemaphores(renderFinishedSemaphores[0].get())
-            .setWaitDstStageMask(waitStage);
-    context->queues[VulkanContext::Queue::COMPUTE].queue.submit(submitInfo, inflightFences[0].get());
+    std::array<vk::SubmitInfo, 2> submitInfos = {
+            vk::SubmitInfo{}.setCommandBuffers(preprocessCommandBuffer.get()),
+            vk::SubmitInfo{}.setWaitSemaphores(swapchain->imageAvailableSemaphores[0].get())
+                    .setCommandBuffers(renderCommandBuffer.get())
+                    .setSignalSemaphores(renderFinishedSemaphores[0].get())
+                    .setWaitDstStageMask(waitStage)
+    };
+    context->submit(VulkanContext::Queue::COMPUTE, submitInfos, inflightFences[0].get());
 
     vk::PresentInfoKHR presentInfo{};
     presentInfo.waitSemaphoreCount = 1;
@@ -579,7 +1043,7 @@ startOfRenderLoop:
     presentInfo.pImageIndices = &currentImageIndex;
 
     try {
-        ret = context->queues[VulkanContext::Queue::PRESENT].queue.presentKHR(presentInfo);
+        ret = context->present(presentInfo);
     } catch (vk::OutOfDateKHRError& e) {
         recreateSwapchain();
         return;
@@ -598,6 +1062,16 @@ void Renderer::run() {
     int num_frames = 0;
     static int frameCounter = 0;
 
+    if (profilingMode == ORDER) {
+        runOrderBenchmark();
+    }
+    if (profilingMode == PRUNE) {
+        runPruneReport();
+    }
+    if (profilingMode == EXTENTS) {
+        runExtentReport();
+    }
+
     while (running) {
         if (!window->tick()) {
             break;
@@ -623,22 +1097,26 @@ void Renderer::run() {
 //        }
 
         if(switchScene){
-            LOGD("Swapping scenes");
-            uniformBuffer.reset();
-            vertexAttributeBuffer.reset();
-            tileOverlapBuffer.reset();
-            prefixSumPingBuffer.reset();
-            prefixSumPongBuffer.reset();
-            sortKBufferEven.reset();
-            sortKBufferOdd.reset();
-            sortHistBuffer.reset();
-            totalSumBufferHost.reset();
-            tileBoundaryBuffer.reset();
-            sortVBufferEven.reset();
-            sortVBufferOdd.reset();
             switchScene = false;
-            break;
+            // one load at a time, the current scene keeps rendering until the next one is drawable
+            if (!sceneLoad.valid() && !configuration.scenePaths.empty()) {
+                int next = (scenePathIndex + 1) % static_cast<int>(configuration.scenePaths.size());
+                auto path = configuration.scenePaths[next];
+                if (auto cached = gpuScenes.acquire(path)) {
+                    // already on the GPU: rebind and resize the scratch buffers, nothing to load
+                    pendingScenePathIndex = next;
+                    swapScene(std::move(cached));
+                    pushSceneCacheMetrics();
+                } else {
+                    LOGD("Loading scene %s in the background", path.c_str());
+                    startSceneLoad([assetManager = assetManager, path]() {
+                        return MappedAsset::fromAsset(assetManager, path.c_str());
+                    }, next);
+                }
+            }
         }
+
+        pollSceneLoad();
     }
     context->device->waitIdle();
 }
@@ -647,6 +1125,9 @@ void Renderer::stop() {
     // wait till device is idle
     running = false;
 
+    if (sceneLoad.valid()) {
+        sceneLoad.wait();
+    }
     context->device->waitIdle();
 }
 
@@ -681,26 +1162,38 @@ void Renderer::recordPreprocessCommandBuffer() {
 
     preprocessCommandBuffer->resetQueryPool(context->queryPool.get(), 0, 12);
 
+    // no splat visible and an empty indirect dispatch until preprocess appends
+    VisibleSplats visibleReset{{0, 1, 1}, 0, 0, 0, {0, 1, 1}, {0, 1, 1}, 0};
+    preprocessCommandBuffer->updateBuffer(visibleSplatsBuffer->buffer, 0, sizeof(VisibleSplats), &visibleReset);
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(visibleSplatsBuffer, vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+            .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eTransfer,
+                   vk::PipelineStageFlagBits::eComputeShader);
+
     preprocessPipeline->bind(preprocessCommandBuffer, 0, 0);
     writeTimestamp("preprocess_start", preprocessCommandBuffer);
     preprocessCommandBuffer->dispatch(numGroups, 1, 1);
-    tileOverlapBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
-
-    vk::BufferCopy copyRegion = {0, 0, tileOverlapBuffer->size};
-    preprocessCommandBuffer->copyBuffer(tileOverlapBuffer->buffer, prefixSumPingBuffer->buffer, 1, &copyRegion);
-
     prefixSumPingBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(visibleSplatsBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead |
+                              vk::AccessFlagBits::eShaderWrite)
+            .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader);
 
     writeTimestamp("preprocess_end", preprocessCommandBuffer);
 
+    // the pass count follows the scene size, passes past the visible count only copy
     prefixSumPipeline->bind(preprocessCommandBuffer, 0, 0);
     writeTimestamp("prefix_sum_start", preprocessCommandBuffer);
     const auto iters = static_cast<uint32_t>(std::ceil(std::log2(static_cast<float>(scene->getNumVertices()))));
     for (uint32_t timestep = 0; timestep <= iters; timestep++) {
+        uint32_t constants[2] = {timestep, iters};
         preprocessCommandBuffer->pushConstants(prefixSumPipeline->pipelineLayout.get(),
                                                vk::ShaderStageFlagBits::eCompute, 0,
-                                               sizeof(uint32_t), &timestep);
-        preprocessCommandBuffer->dispatch(numGroups, 1, 1);
+                                               sizeof(uint32_t) * 2, constants);
+        preprocessCommandBuffer->dispatchIndirect(visibleSplatsBuffer->buffer, 0);
 
         if (timestep % 2 == 0) {
             prefixSumPongBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
@@ -711,14 +1204,27 @@ void Renderer::recordPreprocessCommandBuffer() {
         }
     }
 
-    auto totalSumRegion = vk::BufferCopy{(scene->getNumVertices() - 1) * sizeof(uint32_t), 0, sizeof(uint32_t)};
-    if (iters % 2 == 0) {
-        preprocessCommandBuffer->copyBuffer(prefixSumPingBuffer->buffer, totalSumBufferHost->buffer, 1,
-                                            &totalSumRegion);
-    } else {
-        preprocessCommandBuffer->copyBuffer(prefixSumPongBuffer->buffer, totalSumBufferHost->buffer, 1,
-                                            &totalSumRegion);
-    }
+    visibleSplatsBuffer->computeWriteReadBarrier(preprocessCommandBuffer.get());
+    // the sort and tile boundary dispatches of the render command buffer follow from the scan total
+    sortDispatchPipeline->bind(preprocessCommandBuffer, 0, 0);
+    uint32_t sortDispatchConstants[2] = {getSortCapacity(), numRadixSortBlocksPerWorkgroup};
+    preprocessCommandBuffer->pushConstants(sortDispatchPipeline->pipelineLayout.get(),
+                                           vk::ShaderStageFlagBits::eCompute, 0,
+                                           sizeof(uint32_t) * 2, sortDispatchConstants);
+    preprocessCommandBuffer->dispatch(1, 1, 1);
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(visibleSplatsBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eIndirectCommandRead |
+                              vk::AccessFlagBits::eShaderRead)
+            .build(preprocessCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eDrawIndirect |
+                   vk::PipelineStageFlagBits::eComputeShader);
+    // read on the host after the frame's fence, the sort buffers grow from it before the next frame
+    std::array<vk::BufferCopy, 2> totalSumRegions = {
+            vk::BufferCopy{offsetof(VisibleSplats, count), 0, sizeof(uint32_t) * 2},
+            vk::BufferCopy{offsetof(VisibleSplats, shEvaluations), sizeof(uint32_t) * 2, sizeof(uint32_t)}
+    };
+    preprocessCommandBuffer->copyBuffer(visibleSplatsBuffer->buffer, totalSumBufferHost->buffer, totalSumRegions);
 
     writeTimestamp("prefix_sum_end", preprocessCommandBuffer);
 
@@ -726,54 +1232,24 @@ void Renderer::recordPreprocessCommandBuffer() {
 }
 
 
-bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
+void Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
     if (!renderCommandBuffer) {
         renderCommandBuffer = std::move(context->device->allocateCommandBuffersUnique(
             vk::CommandBufferAllocateInfo(commandPool.get(), vk::CommandBufferLevel::ePrimary, 1))[0]);
     }
 
-    uint32_t numInstances = totalSumBufferHost->readOne<uint32_t>();
-//    LOGD("Num instances: %i, Num Vertices: %i", numInstances, scene->getNumVertices());
-    guiManager.pushTextMetric("instances", numInstances);
-    guiManager.pushTextMetric("fps", realerFps);
-    if (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
-        auto old = sortBufferSizeMultiplier;
-        while (numInstances > scene->getNumVertices() * sortBufferSizeMultiplier) {
-            sortBufferSizeMultiplier++;
-        }
-        LOGD("Reallocating sort buffers. %i -> %i", old, sortBufferSizeMultiplier);
-        sortKBufferEven->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-        sortKBufferOdd->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-        sortVBufferEven->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-        sortVBufferOdd->realloc(scene->getNumVertices() * sizeof(uint32_t) * sortBufferSizeMultiplier);
-
-        uint32_t globalInvocationSize = scene->getNumVertices() * sortBufferSizeMultiplier /
-                                        numRadixSortBlocksPerWorkgroup;
-        uint32_t remainder = scene->getNumVertices() * sortBufferSizeMultiplier % numRadixSortBlocksPerWorkgroup;
-        globalInvocationSize += remainder > 0 ? 1 : 0;
-
-        auto numWorkgroups = (globalInvocationSize + 256 - 1) / 256;
-
-        sortHistBuffer->realloc(numWorkgroups * 256 * sizeof(uint32_t));
-
-        recordPreprocessCommandBuffer();
-        return false;
-    }
-
+    // every count below the preprocess pass lives on the GPU, the dispatches are indirect
     renderCommandBuffer->reset({});
     renderCommandBuffer->begin(vk::CommandBufferBeginInfo{});
 
-#ifdef VKGS_ENABLE_METAL
-    if (numInstances == 0 && __APPLE__) {
-        renderCommandBuffer->end();
-        return true;
-    }
-#endif
-
     vertexAttributeBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
+    Utils::BarrierBuilder().queueFamilyIndex(context->queues[VulkanContext::Queue::COMPUTE].queueFamily)
+            .addBufferBarrier(visibleSplatsBuffer, vk::AccessFlagBits::eShaderWrite,
+                              vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead)
+            .build(renderCommandBuffer.get(), vk::PipelineStageFlagBits::eComputeShader,
+                   vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader);
 
     const auto iters = static_cast<uint32_t>(std::ceil(std::log2(static_cast<float>(scene->getNumVertices()))));
-    auto numGroups = (scene->getNumVertices() + 255) / 256;
     preprocessSortPipeline->bind(renderCommandBuffer, 0, iters % 2 == 0 ? 0 : 1);
     writeTimestamp("preprocess_sort_start", renderCommandBuffer);
     uint32_t tileX = (swapchain->swapchainExtent.width + 16 - 1) / 16;
@@ -781,33 +1257,26 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
     renderCommandBuffer->pushConstants(preprocessSortPipeline->pipelineLayout.get(),
                                            vk::ShaderStageFlagBits::eCompute, 0,
                                            sizeof(uint32_t), &tileX);
-    renderCommandBuffer->dispatch(numGroups, 1, 1);
+    renderCommandBuffer->dispatchIndirect(visibleSplatsBuffer->buffer, 0);
 
     sortKBufferEven->computeWriteReadBarrier(renderCommandBuffer.get());
 
     writeTimestamp("preprocess_sort_end", renderCommandBuffer);
 
-    // std::cout << "Num instances: " << numInstances << std::endl;
-
-    assert(numInstances <= scene->getNumVertices() * sortBufferSizeMultiplier);
     renderCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, context->queryPool.get(),
                                                 queryManager->registerQuery("sort_start"));
     for (auto i = 0; i < 4; i++) {
         sortHistPipeline->bind(renderCommandBuffer, 0, i % 2 == 0 ? 0 : 1);
-        auto invocationSize = (numInstances + numRadixSortBlocksPerWorkgroup - 1) / numRadixSortBlocksPerWorkgroup;
-        invocationSize = (invocationSize + 255) / 256;
 
         RadixSortPushConstants pushConstants{};
-        pushConstants.g_num_elements = numInstances;
         pushConstants.g_num_blocks_per_workgroup = numRadixSortBlocksPerWorkgroup;
         // THIS AFFECTS THE NOISE!
         pushConstants.g_shift = i * 8;
-        pushConstants.g_num_workgroups = invocationSize;
         renderCommandBuffer->pushConstants(sortHistPipeline->pipelineLayout.get(),
                                            vk::ShaderStageFlagBits::eCompute, 0,
                                            sizeof(RadixSortPushConstants), &pushConstants);
 
-        renderCommandBuffer->dispatch(invocationSize, 1, 1);
+        renderCommandBuffer->dispatchIndirect(visibleSplatsBuffer->buffer, offsetof(VisibleSplats, sortGroups));
 
         sortHistBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
 
@@ -815,7 +1284,7 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
         renderCommandBuffer->pushConstants(sortPipeline->pipelineLayout.get(),
                                            vk::ShaderStageFlagBits::eCompute, 0,
                                            sizeof(RadixSortPushConstants), &pushConstants);
-        renderCommandBuffer->dispatch(invocationSize, 1, 1);
+        renderCommandBuffer->dispatchIndirect(visibleSplatsBuffer->buffer, offsetof(VisibleSplats, sortGroups));
 
         if (i % 2 == 0) {
             sortKBufferOdd->computeWriteReadBarrier(renderCommandBuffer.get());
@@ -838,10 +1307,7 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
     // Since we have 64 bit keys, the sort result is always in the even buffer
     tileBoundaryPipeline->bind(renderCommandBuffer, 0, 0);
     writeTimestamp("tile_boundary_start", renderCommandBuffer);
-    renderCommandBuffer->pushConstants(tileBoundaryPipeline->pipelineLayout.get(),
-                                       vk::ShaderStageFlagBits::eCompute, 0,
-                                       sizeof(uint32_t), &numInstances);
-    renderCommandBuffer->dispatch((numInstances + 255) / 256, 1, 1);
+    renderCommandBuffer->dispatchIndirect(visibleSplatsBuffer->buffer, offsetof(VisibleSplats, instanceGroups));
 
     tileBoundaryBuffer->computeWriteReadBarrier(renderCommandBuffer.get());
     writeTimestamp("tile_boundary_end", renderCommandBuffer);
@@ -912,8 +1378,6 @@ bool Renderer::recordRenderCommandBuffer(uint32_t currentFrame) {
                                              vk::DependencyFlagBits::eByRegion, nullptr, nullptr, imageMemoryBarrier);
     }
     renderCommandBuffer->end();
-
-    return true;
 }
 
 void Renderer::updateUniforms() {
@@ -935,6 +1399,22 @@ void Renderer::updateUniforms() {
                                      camera.nearPlane,
                                      camera.farPlane) * view;
 
+    // the GPU is done with the previous frame, slots can be evicted and refilled
+    if (auto residency = scene->getResidency()) {
+        residency->update(data.proj_mat, camera.position);
+        const auto& slotSplats = residency->getSlotSplats();
+        slotTableBuffer->upload(slotSplats.data(), slotSplats.size() * sizeof(uint32_t));
+        data.chunk_splats = residency->getSlotCapacity();
+        guiManager.pushTextMetric("resident chunks", static_cast<float>(residency->getResidentChunks()));
+        guiManager.pushTextMetric("chunk fetches", static_cast<float>(residency->getFetchCount()));
+        guiManager.pushTextMetric("chunk evictions", static_cast<float>(residency->getEvictionCount()));
+    }
+
+    data.color_cache_cos = configuration.colorCacheTolerance > 0.0f
+                           ? std::cos(glm::radians(configuration.colorCacheTolerance)) : 2.0f;
+    data.color_refresh_period = configuration.colorCacheRefreshPeriod;
+    data.frame_index = static_cast<uint32_t>(frame_count);
+
     data.view_mat[0][1] *= -1.0f;
     data.view_mat[1][1] *= -1.0f;
     data.view_mat[2][1] *= -1.0f;
@@ -950,6 +1430,7 @@ void Renderer::updateUniforms() {
     data.proj_mat[3][1] *= -1.0f;
     data.tan_fovx = tan_fovx;
     data.tan_fovy = tan_fovy;
+    data.resident_splats = static_cast<uint32_t>(scene->getResidentVertices());
     uniformBuffer->upload(&data, sizeof(UniformBuffer), 0);
 }
 
@@ -1095,14 +1576,8 @@ std::vector<float> Renderer::retrieveRenderedImage() {
             nullptr, nullptr, barrier
     );
 
-    cmdBuffer->end();
-
     // Submit the command buffer and wait for it to finish.
-    vk::SubmitInfo submitInfo{};
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &*cmdBuffer;
-    context->queues[VulkanContext::Queue::PRESENT].queue.submit(submitInfo, nullptr);
-    context->queues[VulkanContext::Queue::PRESENT].queue.waitIdle();
+    context->endOneTimeCommandBuffer(std::move(cmdBuffer), VulkanContext::Queue::PRESENT);
 
     // Retrieve the pixel data from the staging buffer as unsigned char.
     std::vector<unsigned char> rawPixels(width * height * 4);
@@ -1118,4 +1593,8 @@ std::vector<float> Renderer::retrieveRenderedImage() {
 }
 
 Renderer::~Renderer() {
+    // a load still in flight holds buffers of this device and this renderer
+    if (sceneLoad.valid()) {
+        sceneLoad.wait();
+    }
 }
@@ -3,7 +3,12 @@
 
 #define GLM_SWIZZLE
 
+#include <array>
 #include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <cmath>
 #include <stdexcept>
@@ -14,6 +19,7 @@
 
 #include "vulkan/Window.h"
 #include "GSScene.h"
+#include "GpuSceneCache.h"
 #include "vulkan/pipelines/ComputePipeline.h"
 #include "vulkan/Swapchain.h"
 #include <glm/gtc/quaternion.hpp>
@@ -33,6 +39,13 @@ public:
         uint32_t height;
         float tan_fovx;
         float tan_fovy;
+        uint32_t resident_splats;
+        // slot size of an out-of-core scene, 0 when the whole scene is resident
+        uint32_t chunk_splats;
+        // cosine of RendererConfiguration::colorCacheTolerance, 2 turns the color cache off
+        float color_cache_cos;
+        uint32_t color_refresh_period;
+        uint32_t frame_index;
     };
 
     struct VertexAttributeBuffer {
@@ -41,7 +54,23 @@ public:
         glm::uvec4 aabb;
         glm::vec2 uv;
         float depth;
-        uint32_t __padding[1];
+        float cutoffSq;
+    };
+
+    // Indirect arguments of the frame, written on the GPU (VisibleSplats in common.glsl). Preprocess appends the
+    // splats that survive culling, prefix_sum adds the scan total and sort_dispatch clamps it to the sort buffers.
+    struct VisibleSplats {
+        // prefix_sum and preprocess_sort over the visible splats
+        vk::DispatchIndirectCommand groups;
+        uint32_t count;
+        // read back after the frame to grow the sort buffers
+        uint32_t instances;
+        uint32_t sortedInstances;
+        vk::DispatchIndirectCommand sortGroups;
+        // tile_boundary over the sorted instances
+        vk::DispatchIndirectCommand instanceGroups;
+        // visible splats that missed the color cache
+        uint32_t shEvaluations;
     };
 
     struct Camera {
@@ -80,10 +109,9 @@ public:
             },
     };
 
+    // the element and workgroup counts are read from VisibleSplats
     struct RadixSortPushConstants {
-        uint32_t g_num_elements; // == NUM_ELEMENTS
         uint32_t g_shift; // (*)
-        uint32_t g_num_workgroups; // == NUMBER_OF_WORKGROUPS as defined in the section above
         uint32_t g_num_blocks_per_workgroup; // == NUM_BLOCKS_PER_WORKGROUP
     };
 
@@ -97,7 +125,17 @@ public:
 
     void moveCameraForProfiling();
 
-    void retrieveTimestamps();
+    // camera at pose index of the profiling trajectory
+    void applyProfilingPose(size_t index);
+
+    // GPU time per pass in ns, also pushed to the GUI
+    std::unordered_map<std::string, uint64_t> retrieveTimestamps();
+
+    void runOrderBenchmark();
+
+    void runPruneReport();
+
+    void runExtentReport();
 
     void recreateSwapchain();
 
@@ -130,8 +168,7 @@ public:
     Camera camera;
 
     ProfilingMode profilingMode = NONE;
-    std::vector<glm::mat3x3> rotations;
-    std::vector<glm::vec3> translations;
+    std::vector<CameraPose> trajectory;
     int cameraPosIndex = 0;
     AAssetManager * assetManager;
     bool showMetrics = true;
@@ -158,20 +195,37 @@ private:
     std::shared_ptr<VulkanContext> context;
     std::shared_ptr<ImguiManager> imguiManager;
     std::shared_ptr<GSScene> scene;
+    // background load; its scene is swapped in at the first frame boundary after a batch is drawable
+    std::future<void> sceneLoad;
+    std::mutex pendingSceneMutex;
+    std::shared_ptr<GSScene> pendingScene;
+    int scenePathIndex = 0;
+    int pendingScenePathIndex = 0;
+    // scenes loaded from configuration.scenePaths, including the one being drawn
+    GpuSceneCache gpuScenes;
     std::shared_ptr<QueryManager> queryManager = std::make_shared<QueryManager>();
     GUIManager guiManager {};
 
     std::shared_ptr<ComputePipeline> preprocessPipeline;
+    // one variant per SH degree and extent mode, built on first use and kept across scene switches
+    std::array<std::shared_ptr<ComputePipeline>, 8> preprocessPipelines;
+    // RendererConfiguration::tightExtents, switched by the EXTENTS report
+    bool tightExtents = true;
     std::shared_ptr<ComputePipeline> renderPipeline;
     std::shared_ptr<ComputePipeline> prefixSumPipeline;
     std::shared_ptr<ComputePipeline> preprocessSortPipeline;
     std::shared_ptr<ComputePipeline> sortHistPipeline;
     std::shared_ptr<ComputePipeline> sortPipeline;
+    std::shared_ptr<ComputePipeline> sortDispatchPipeline;
     std::shared_ptr<ComputePipeline> tileBoundaryPipeline;
 
     std::shared_ptr<Buffer> uniformBuffer;
+    // splats drawn per slot of an out-of-core scene, written with the uniforms
+    std::shared_ptr<Buffer> slotTableBuffer;
     std::shared_ptr<Buffer> vertexAttributeBuffer;
-    std::shared_ptr<Buffer> tileOverlapBuffer;
+    std::shared_ptr<Buffer> visibleSplatsBuffer;
+    // ColorCacheEntry per splat, see preprocess.glsl
+    std::shared_ptr<Buffer> colorCacheBuffer;
     std::shared_ptr<Buffer> prefixSumPingBuffer;
     std::shared_ptr<Buffer> prefixSumPongBuffer;
     std::shared_ptr<Buffer> sortKBufferEven;
@@ -183,6 +237,7 @@ private:
     std::shared_ptr<Buffer> sortVBufferOdd;
 
     std::shared_ptr<DescriptorSet> inputSet;
+    std::shared_ptr<DescriptorSet> preprocessOutputSet;
 
     std::atomic<bool> running = true;
 
@@ -222,11 +277,49 @@ private:
     uint32_t thirtySecondFrameCount = 0;
     float thirtySecondAvgFps = 0.0f;
     bool thirtySecondIntervalStarted = false;
+    // splats drawn and splats that missed the color cache over the interval, logged with the FPS
+    uint64_t thirtySecondVisibleSplats = 0;
+    uint64_t thirtySecondShEvaluations = 0;
 
     void initializeVulkan();
 
     void loadSceneToGPU();
 
+    void pushLoadMetrics();
+
+    GSScene::LoadOptions getLoadOptions() const;
+
+    void startSceneLoad(std::function<std::shared_ptr<MappedAsset>()> openAsset, int index);
+
+    std::shared_ptr<GSScene> takeDrawableScene();
+
+    void pollSceneLoad();
+
+    void swapScene(std::shared_ptr<GSScene> next);
+
+    // keeps the scene just swapped in for later visits
+    void cacheScene();
+
+    void pushSceneCacheMetrics();
+
+    void bindScene();
+
+    vk::DeviceSize getSortHistSize() const;
+
+    uint32_t getSortCapacity() const;
+
+    // grows the sort buffers to hold numInstances, only while no frame is in flight
+    void growSortBuffers(uint32_t numInstances);
+
+    vk::DeviceSize getSlotTableSize() const;
+
+    vk::DeviceSize getColorCacheSize() const;
+
+    // every splat evaluates its SH on the next frame, for a new scene or one whose splats moved
+    void clearColorCache();
+
+    std::shared_ptr<ComputePipeline> getPreprocessPipeline(uint32_t shDegree);
+
     void createPreprocessPipeline();
 
     void createPrefixSumPipeline();
@@ -243,7 +336,7 @@ private:
 
     void recordPreprocessCommandBuffer();
 
-    bool recordRenderCommandBuffer(uint32_t currentFrame);
+    void recordRenderCommandBuffer(uint32_t currentFrame);
 
     void createCommandPool();
 
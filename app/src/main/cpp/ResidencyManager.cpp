@@ -0,0 +1,172 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "base_utils.h"
+
+namespace {
+
+// Planes of the clip volume as (normal, d) with the inside positive; works for any projection convention
+// because the near plane is taken from w + z and the box test is conservative
+std::array<glm::vec4, 6> frustumPlanes(const glm::mat4 & m) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+}
+
+bool intersectsFrustum(const std::array<glm::vec4, 6> & planes, const glm::vec3 & boundsMin,
+                       const glm::vec3 & boundsMax) {
+    for (const auto & plane: planes) {
+        // the corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? boundsMax.x : boundsMin.x,
+                         plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+                         plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ResidencyManager::ResidencyManager(std::vector<Chunk> _chunks, uint32_t slotCount, uint32_t _slotCapacity,
+                                   FetchFunction _fetch)
+    : chunks(std::move(_chunks)), slotCapacity(_slotCapacity), fetch(std::move(_fetch)) {
+    if (slotCount == 0) {
+        throw std::runtime_error("Residency budget does not fit a single chunk");
+    }
+    states.assign(chunks.size(), State::EVICTED);
+    chunkSlots.assign(chunks.size(), 0);
+    lastVisible.assign(chunks.size(), 0);
+    slotSplats.assign(slotCount, 0);
+    for (uint32_t slot = slotCount; slot > 0; slot--) {
+        freeSlots.push_back(slot - 1);
+    }
+    loader = std::thread(&ResidencyManager::loaderLoop, this);
+}
+
+ResidencyManager::~ResidencyManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requested.clear();
+    }
+    fetchAvailable.notify_all();
+    loader.join();
+}
+
+void ResidencyManager::update(const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition) {
+    frame++;
+
+    std::vector<Fetch> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.swap(finished);
+    }
+    for (const auto & fetched: done) {
+        pendingFetches--;
+        if (fetched.failed) {
+            states[fetched.chunk] = State::EVICTED;
+            freeSlots.push_back(fetched.slot);
+            continue;
+        }
+        states[fetched.chunk] = State::RESIDENT;
+        slotSplats[fetched.slot] = static_cast<uint32_t>(chunks[fetched.chunk].count);
+        residentChunks++;
+        fetchCount++;
+    }
+
+    // visible chunks by distance to the camera, the nearest getSlotCount() of them are wanted
+    auto planes = frustumPlanes(viewProjection);
+    std::vector<std::pair<float, size_t>> visible;
+    for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+        const auto & bounds = chunks[chunk];
+        if (!intersectsFrustum(planes, bounds.boundsMin, bounds.boundsMax)) {
+            continue;
+        }
+        lastVisible[chunk] = frame;
+        float distance = glm::distance(cameraPosition, glm::clamp(cameraPosition, bounds.boundsMin, bounds.boundsMax));
+        visible.emplace_back(distance, chunk);
+    }
+    std::sort(visible.begin(), visible.end());
+    size_t wanted = std::min<size_t>(visible.size(), getSlotCount());
+    std::vector<size_t> rank(chunks.size(), std::numeric_limits<size_t>::max());
+    for (size_t i = 0; i < visible.size(); i++) {
+        rank[visible[i].second] = i;
+    }
+
+    for (size_t i = 0; i < wanted && pendingFetches < MAX_PENDING_FETCHES; i++) {
+        size_t chunk = visible[i].second;
+        if (states[chunk] != State::EVICTED) {
+            continue;
+        }
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            // least recently visible first, among the chunks visible this frame the farthest
+            size_t victim = chunks.size();
+            for (size_t candidate = 0; candidate < chunks.size(); candidate++) {
+                if (states[candidate] != State::RESIDENT || rank[candidate] < wanted) {
+                    continue;
+                }
+                if (victim == chunks.size() || lastVisible[candidate] < lastVisible[victim] ||
+                    (lastVisible[candidate] == lastVisible[victim] && rank[candidate] > rank[victim])) {
+                    victim = candidate;
+                }
+            }
+            if (victim == chunks.size()) {
+                // every slot holds a wanted chunk or is being filled
+                break;
+            }
+            slot = chunkSlots[victim];
+            states[victim] = State::EVICTED;
+            slotSplats[slot] = 0;
+            residentChunks--;
+            evictionCount++;
+        }
+
+        states[chunk] = State::LOADING;
+        chunkSlots[chunk] = slot;
+        pendingFetches++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requested.push_back({chunk, slot});
+        }
+        fetchAvailable.notify_one();
+    }
+}
+
+void ResidencyManager::loaderLoop() {
+    while (true) {
+        Fetch next{};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fetchAvailable.wait(lock, [this] { return stopping || !requested.empty(); });
+            if (stopping) {
+                return;
+            }
+            next = requested.front();
+            requested.pop_front();
+        }
+
+        try {
+            fetch(next.chunk, next.slot);
+        } catch (const std::exception & e) {
+            LOGO("Fetching chunk %zu failed: %s", next.chunk, e.what());
+            next.failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(next);
+    }
+}
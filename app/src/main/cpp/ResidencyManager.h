@@ -0,0 +1,105 @@
+#ifndef RESIDENCYMANAGER_H
+#define RESIDENCYMANAGER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Keeps a budgeted subset of a chunked scene on the GPU. The GPU buffers are split into slots of slotCapacity
+// splats each; update() picks the chunks worth keeping from the camera frustum and distance, evicts the chunks
+// that were visible least recently and hands missing ones to a loader thread that fills their slots.
+// Slot i draws getSlotSplats()[i] splats, 0 while it is empty or still being filled.
+class ResidencyManager {
+public:
+    struct Chunk {
+        // splat range in the (spatially ordered) source
+        size_t first = 0;
+        size_t count = 0;
+        // bounds of the splats including their 3 sigma extent
+        glm::vec3 boundsMin{0.0f};
+        glm::vec3 boundsMax{0.0f};
+    };
+
+    // fetch(chunk, slot) uploads the chunk into the slot; runs on the loader thread
+    using FetchFunction = std::function<void(size_t chunk, uint32_t slot)>;
+
+    ResidencyManager(std::vector<Chunk> chunks, uint32_t slotCount, uint32_t slotCapacity, FetchFunction fetch);
+
+    ResidencyManager(const ResidencyManager &) = delete;
+
+    ResidencyManager &operator=(const ResidencyManager &) = delete;
+
+    // waits for the fetch in progress, the slots it writes have to outlive it
+    ~ResidencyManager();
+
+    // Called once per frame while the GPU does not read the scene buffers. Publishes finished fetches, then
+    // requests the visible chunks nearest to the camera, evicting the least recently visible ones for them.
+    void update(const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition);
+
+    const std::vector<uint32_t> & getSlotSplats() const { return slotSplats; }
+
+    const Chunk & getChunk(size_t chunk) const { return chunks[chunk]; }
+
+    size_t getChunkCount() const { return chunks.size(); }
+
+    uint32_t getSlotCount() const { return static_cast<uint32_t>(slotSplats.size()); }
+
+    uint32_t getSlotCapacity() const { return slotCapacity; }
+
+    // splats the GPU buffers hold
+    uint64_t getCapacity() const { return static_cast<uint64_t>(getSlotCount()) * slotCapacity; }
+
+    size_t getResidentChunks() const { return residentChunks; }
+
+    size_t getFetchCount() const { return fetchCount; }
+
+    size_t getEvictionCount() const { return evictionCount; }
+
+    // fetches hold the slot until they finish, more in flight only delays reacting to camera movement
+    static constexpr size_t MAX_PENDING_FETCHES = 4;
+
+private:
+    enum class State : uint8_t {
+        EVICTED,
+        LOADING,
+        RESIDENT,
+    };
+
+    struct Fetch {
+        size_t chunk;
+        uint32_t slot;
+        bool failed = false;
+    };
+
+    void loaderLoop();
+
+    std::vector<Chunk> chunks;
+    std::vector<State> states;
+    std::vector<uint32_t> chunkSlots;
+    // frame a chunk was last inside the frustum, evictions pick the oldest
+    std::vector<uint64_t> lastVisible;
+    std::vector<uint32_t> slotSplats;
+    std::vector<uint32_t> freeSlots;
+    uint32_t slotCapacity;
+    uint64_t frame = 0;
+    size_t residentChunks = 0;
+    size_t pendingFetches = 0;
+    size_t fetchCount = 0;
+    size_t evictionCount = 0;
+
+    FetchFunction fetch;
+    std::mutex mutex;
+    std::condition_variable fetchAvailable;
+    std::deque<Fetch> requested;
+    std::vector<Fetch> finished;
+    bool stopping = false;
+    std::thread loader;
+};
+
+#endif //RESIDENCYMANAGER_H
@@ -0,0 +1,145 @@
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "WorkerPool.h"
+#include "base_utils.h"
+
+namespace {
+
+constexpr char MAGIC[8] = {'3', 'D', 'G', 'S', 'S', 'C', 'N', '\0'};
+constexpr size_t HASH_CHUNK = 1 << 20;
+constexpr uint64_t HASH_PRIME = 0x9E3779B97F4A7C15ull;
+
+inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// four independent lanes so the multiplies overlap instead of forming one long dependency chain
+uint64_t hashChunk(const char *data, size_t size, uint64_t seed) {
+    uint64_t lanes[4] = {seed, seed ^ HASH_PRIME, seed + HASH_PRIME, ~seed};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            std::memcpy(&word, data + i + l * 8, sizeof(word));
+            lanes[l] = (lanes[l] ^ word) * HASH_PRIME;
+            lanes[l] = (lanes[l] << 31) | (lanes[l] >> 33);
+        }
+    }
+    uint64_t h = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3);
+    for (; i < size; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * HASH_PRIME;
+    }
+    return mix(h ^ size);
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+uint64_t SceneCache::hashContent(const char *data, size_t size) {
+    size_t numChunks = (size + HASH_CHUNK - 1) / HASH_CHUNK;
+    std::vector<uint64_t> chunkHashes(numChunks);
+    WorkerPool::shared().parallelFor(numChunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t offset = c * HASH_CHUNK;
+            chunkHashes[c] = hashChunk(data + offset, std::min(HASH_CHUNK, size - offset), c);
+        }
+    }, 1);
+    return hashChunk(reinterpret_cast<const char *>(chunkHashes.data()), numChunks * sizeof(uint64_t), size);
+}
+
+std::string SceneCache::pathFor(const std::string &cacheDir, uint64_t sourceHash, uint32_t storage,
+                                uint32_t maxShDegree, uint32_t splatOrder) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%u-%u-%u.gscache", static_cast<unsigned long long>(sourceHash), storage,
+                  maxShDegree, splatOrder);
+    return cacheDir + "/" + name;
+}
+
+std::shared_ptr<SceneCache> SceneCache::open(const std::string &path, uint64_t sourceHash, uint64_t sourceSize,
+                                             uint32_t storage, uint32_t splatOrder) {
+    auto file = MappedAsset::fromFile(path);
+    if (file == nullptr || file->size() < sizeof(SceneCacheHeader)) {
+        return nullptr;
+    }
+
+    SceneCacheHeader header{};
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.storage != storage || header.splatOrder != splatOrder) {
+        LOGD("Scene cache %s is from another version, ignoring it", path.c_str());
+        return nullptr;
+    }
+    if (header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+        return nullptr;
+    }
+    if (header.vertexBytes != header.numSplats * header.vertexSize ||
+        header.vertexOffset + header.vertexBytes > file->size() ||
+        header.cov3DOffset + header.cov3DBytes > file->size() ||
+        (header.storageDataBytes > 0 && header.storageDataOffset + header.storageDataBytes > file->size()) ||
+        (header.orderBytes > 0 && (header.orderBytes != header.numSplats * sizeof(uint32_t) ||
+                                   header.orderOffset + header.orderBytes > file->size()))) {
+        LOGO("Scene cache %s is truncated, ignoring it", path.c_str());
+        return nullptr;
+    }
+    return std::shared_ptr<SceneCache>(new SceneCache(std::move(file), header));
+}
+
+void SceneCache::write(const std::string &path, SceneCacheHeader header,
+                       const std::function<void(Section, std::ostream &)> &writeSection) {
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexOffset = alignUp(sizeof(SceneCacheHeader), SECTION_ALIGNMENT);
+    header.cov3DOffset = alignUp(header.vertexOffset + header.vertexBytes, SECTION_ALIGNMENT);
+    header.storageDataOffset = alignUp(header.cov3DOffset + header.cov3DBytes, SECTION_ALIGNMENT);
+    header.orderOffset = alignUp(header.storageDataOffset + header.storageDataBytes, SECTION_ALIGNMENT);
+
+    // write next to the final name and rename, so a crash never leaves a half-written cache behind
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("SceneCache: cannot create " + tmpPath);
+        }
+        std::vector<char> padding(SECTION_ALIGNMENT, 0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(padding.data(), header.vertexOffset - sizeof(header));
+        writeSection(Section::VERTICES, out);
+        out.write(padding.data(), header.cov3DOffset - header.vertexOffset - header.vertexBytes);
+        writeSection(Section::COV3D, out);
+        uint64_t expectedSize = header.cov3DOffset + header.cov3DBytes;
+        if (header.storageDataBytes > 0) {
+            out.write(padding.data(), header.storageDataOffset - expectedSize);
+            writeSection(Section::STORAGE_DATA, out);
+            expectedSize = header.storageDataOffset + header.storageDataBytes;
+        }
+        if (header.orderBytes > 0) {
+            out.write(padding.data(), header.orderOffset - expectedSize);
+            writeSection(Section::ORDER, out);
+            expectedSize = header.orderOffset + header.orderBytes;
+        }
+        if (!out || static_cast<uint64_t>(out.tellp()) != expectedSize) {
+            out.close();
+            std::remove(tmpPath.c_str());
+            throw std::runtime_error("SceneCache: failed to write " + tmpPath);
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("SceneCache: failed to rename " + tmpPath);
+    }
+}
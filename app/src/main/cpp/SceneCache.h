@@ -0,0 +1,98 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "MappedAsset.h"
+
+// On-disk header of a converted scene. The sections hold exactly what the GPU buffers hold, so a cached
+// load is a bulk copy into staging memory with no conversion and no cov3D dispatch.
+struct SceneCacheHeader {
+    char magic[8];
+    uint32_t version;
+    // GSScene::getSplatSize() when the cache was written, guards against layout changes
+    uint32_t vertexSize;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t numSplats;
+    float boundsMin[3];
+    float boundsMax[3];
+    // SplatStorage of the vertex section
+    uint32_t storage;
+    // color PSNR of the quantization, 0 for lossless storage
+    float storagePsnr;
+    // SH degree of the stored splats, after GSScene::LoadOptions::maxShDegree
+    uint32_t shDegree;
+    // SplatOrder of the stored splats
+    uint32_t splatOrder;
+    // byte offsets from the start of the file, page aligned
+    uint64_t vertexOffset;
+    uint64_t vertexBytes;
+    uint64_t cov3DOffset;
+    uint64_t cov3DBytes;
+    // what the storage layout needs next to the splats (chunk ranges, SH codebook), empty for FLOAT32
+    uint64_t storageDataOffset;
+    uint64_t storageDataBytes;
+    // file index of each stored splat (GSScene::getImportOrder), empty for unpruned SplatOrder::FILE_ORDER
+    uint64_t orderOffset;
+    uint64_t orderBytes;
+};
+
+// Binary cache of GPU-ready scenes, one file per source PLY keyed by a hash of its content
+class SceneCache {
+public:
+    // bump whenever the meaning of a section changes
+    static constexpr uint32_t VERSION = 5;
+    static constexpr size_t SECTION_ALIGNMENT = 4096;
+
+    // 64-bit content hash, computed in fixed 1 MB chunks on WorkerPool::shared() so it does not
+    // depend on the number of threads
+    static uint64_t hashContent(const char * data, size_t size);
+
+    // one file per source, storage layout, requested SH degree and splat order, so switching them does not evict
+    // the others
+    static std::string pathFor(const std::string & cacheDir, uint64_t sourceHash, uint32_t storage,
+                               uint32_t maxShDegree, uint32_t splatOrder);
+
+    // Maps a cache file, returns nullptr if it is missing, truncated, from another version or for another source.
+    // The caller checks vertexSize against the layout it expects for header.shDegree.
+    static std::shared_ptr<SceneCache> open(const std::string & path, uint64_t sourceHash, uint64_t sourceSize,
+                                            uint32_t storage, uint32_t splatOrder);
+
+    enum class Section {
+        VERTICES,
+        COV3D,
+        STORAGE_DATA,
+        ORDER,
+    };
+
+    // Fills in magic, version and section offsets, writes to a temporary file and renames it into place.
+    // writeSection streams exactly vertexBytes / cov3DBytes / storageDataBytes / orderBytes into `out`, so sections
+    // never need to be in host memory at once. STORAGE_DATA and ORDER are only requested when their size is not 0.
+    static void write(const std::string & path, SceneCacheHeader header,
+                      const std::function<void(Section section, std::ostream & out)> & writeSection);
+
+    const SceneCacheHeader & getHeader() const { return header; }
+
+    const char * vertexData() const { return file->data() + header.vertexOffset; }
+
+    const char * cov3DData() const { return file->data() + header.cov3DOffset; }
+
+    const char * storageData() const { return file->data() + header.storageDataOffset; }
+
+    const uint32_t * orderData() const { return reinterpret_cast<const uint32_t *>(file->data() + header.orderOffset); }
+
+private:
+    SceneCache(std::shared_ptr<MappedAsset> file, const SceneCacheHeader & header)
+        : file(std::move(file)), header(header) {}
+
+    std::shared_ptr<MappedAsset> file;
+    SceneCacheHeader header;
+};
+
+#endif //SCENECACHE_H
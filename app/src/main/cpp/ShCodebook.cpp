@@ -0,0 +1,188 @@
+#include "ShCodebook.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#include "WorkerPool.h"
+
+namespace {
+
+constexpr size_t R = ShCodebook::REST_COEFFICIENTS;
+// band boundaries in the 45 coefficients; most of the energy is in band 1, so checking the running
+// distance there rejects most entries early
+constexpr size_t BAND_ENDS[] = {9, 24, 45};
+
+// Entries are searched in groups of SEARCH_LANES, stored coefficient-major ([group][coefficient][lane]) so the
+// distance loop runs over lanes and vectorizes without reordering any float sums
+constexpr size_t SEARCH_LANES = 8;
+// large enough that padding lanes never win, small enough that 45 squared differences stay finite
+constexpr float PADDING_VALUE = 1e15f;
+
+std::vector<float> buildSearchLayout(const std::vector<float> & entries) {
+    size_t size = entries.size() / R;
+    size_t numGroups = (size + SEARCH_LANES - 1) / SEARCH_LANES;
+    std::vector<float> groups(numGroups * R * SEARCH_LANES, PADDING_VALUE);
+    for (size_t e = 0; e < size; e++) {
+        for (size_t k = 0; k < R; k++) {
+            groups[((e / SEARCH_LANES) * R + k) * SEARCH_LANES + e % SEARCH_LANES] = entries[e * R + k];
+        }
+    }
+    return groups;
+}
+
+uint32_t findNearest(const std::vector<float> & groups, const float * rest, float * distance) {
+    size_t numGroups = groups.size() / (R * SEARCH_LANES);
+    uint32_t best = 0;
+    float bestDistance = std::numeric_limits<float>::max();
+    for (size_t g = 0; g < numGroups; g++) {
+        const float * group = groups.data() + g * R * SEARCH_LANES;
+        float d[SEARCH_LANES] = {};
+        size_t k = 0;
+        bool rejected = false;
+        for (size_t bandEnd : BAND_ENDS) {
+            for (; k < bandEnd; k++) {
+                for (size_t lane = 0; lane < SEARCH_LANES; lane++) {
+                    float diff = rest[k] - group[k * SEARCH_LANES + lane];
+                    d[lane] += diff * diff;
+                }
+            }
+            if (*std::min_element(d, d + SEARCH_LANES) >= bestDistance) {
+                rejected = true;
+                break;
+            }
+        }
+        if (rejected) {
+            continue;
+        }
+        for (size_t lane = 0; lane < SEARCH_LANES; lane++) {
+            if (d[lane] < bestDistance) {
+                bestDistance = d[lane];
+                best = static_cast<uint32_t>(g * SEARCH_LANES + lane);
+            }
+        }
+    }
+    if (distance != nullptr) {
+        *distance = bestDistance;
+    }
+    return best;
+}
+
+} // namespace
+
+ShCodebook ShCodebook::train(const std::vector<float> & samples) {
+    ShCodebook codebook;
+    size_t numSamples = samples.size() / R;
+    size_t size = std::min(SIZE, numSamples);
+    if (size == 0) {
+        codebook.entries.assign(R, 0.0f);
+        codebook.searchGroups = buildSearchLayout(codebook.entries);
+        return codebook;
+    }
+
+    // fixed seed: the same scene always gets the same codebook
+    std::mt19937 rng(0x5eedu);
+    std::vector<uint32_t> order(numSamples);
+    std::iota(order.begin(), order.end(), 0u);
+    for (size_t i = 0; i < size; i++) {
+        std::swap(order[i], order[i + rng() % (numSamples - i)]);
+    }
+    codebook.entries.resize(size * R);
+    for (size_t e = 0; e < size; e++) {
+        std::memcpy(&codebook.entries[e * R], &samples[order[e] * R], R * sizeof(float));
+    }
+
+    auto & pool = WorkerPool::shared();
+    std::vector<uint32_t> assignment(numSamples);
+    std::vector<float> distance(numSamples);
+    std::vector<uint32_t> memberOffsets(size + 1);
+    std::vector<uint32_t> members(numSamples);
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        codebook.searchGroups = buildSearchLayout(codebook.entries);
+        pool.parallelFor(numSamples, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                assignment[i] = findNearest(codebook.searchGroups, &samples[i * R], &distance[i]);
+            }
+        }, 64);
+
+        // group the samples by entry so every entry can be averaged independently
+        std::fill(memberOffsets.begin(), memberOffsets.end(), 0u);
+        for (uint32_t a : assignment) {
+            memberOffsets[a + 1]++;
+        }
+        std::partial_sum(memberOffsets.begin(), memberOffsets.end(), memberOffsets.begin());
+        std::vector<uint32_t> cursor(memberOffsets.begin(), memberOffsets.end() - 1);
+        for (size_t i = 0; i < numSamples; i++) {
+            members[cursor[assignment[i]]++] = static_cast<uint32_t>(i);
+        }
+
+        pool.parallelFor(size, [&](size_t begin, size_t end) {
+            double sum[R];
+            for (size_t e = begin; e < end; e++) {
+                uint32_t first = memberOffsets[e], last = memberOffsets[e + 1];
+                if (first == last) {
+                    continue;
+                }
+                std::fill(sum, sum + R, 0.0);
+                for (uint32_t m = first; m < last; m++) {
+                    const float * sample = &samples[members[m] * R];
+                    for (size_t k = 0; k < R; k++) {
+                        sum[k] += sample[k];
+                    }
+                }
+                for (size_t k = 0; k < R; k++) {
+                    codebook.entries[e * R + k] = static_cast<float>(sum[k] / (last - first));
+                }
+            }
+        }, 16);
+
+        // empty entries restart at the worst represented samples
+        std::vector<uint32_t> worst;
+        for (size_t e = 0; e < size; e++) {
+            if (memberOffsets[e] != memberOffsets[e + 1]) {
+                continue;
+            }
+            if (worst.empty()) {
+                worst.resize(numSamples);
+                std::iota(worst.begin(), worst.end(), 0u);
+                std::sort(worst.begin(), worst.end(), [&](uint32_t a, uint32_t b) { return distance[a] < distance[b]; });
+            }
+            std::memcpy(&codebook.entries[e * R], &samples[worst.back() * R], R * sizeof(float));
+            worst.pop_back();
+        }
+
+        double totalError = std::accumulate(distance.begin(), distance.end(), 0.0);
+        codebook.trainingError = totalError / (numSamples * R);
+    }
+    codebook.searchGroups = buildSearchLayout(codebook.entries);
+    return codebook;
+}
+
+uint32_t ShCodebook::nearest(const float * rest) const {
+    return findNearest(searchGroups, rest, nullptr);
+}
+
+void ShCodebook::encode(const SplatVertex * src, size_t count, CodebookSplat * dst) const {
+    for (size_t i = 0; i < count; i++) {
+        const SplatVertex & v = src[i];
+        CodebookSplat & out = dst[i];
+        out.position = v.position;
+        out.scale_opacity = v.scale_opacity;
+        out.rotation = v.rotation;
+        std::memcpy(out.shDc, v.shs, sizeof(out.shDc));
+        out.shIndex = static_cast<uint16_t>(nearest(v.shs + 3));
+        out.padding = 0;
+    }
+}
+
+SplatVertex ShCodebook::decode(const CodebookSplat & splat) const {
+    SplatVertex v{};
+    v.position = splat.position;
+    v.scale_opacity = splat.scale_opacity;
+    v.rotation = splat.rotation;
+    std::memcpy(v.shs, splat.shDc, sizeof(splat.shDc));
+    std::memcpy(v.shs + 3, &entries[splat.shIndex * R], R * sizeof(float));
+    return v;
+}
@@ -0,0 +1,62 @@
+#ifndef SHCODEBOOK_H
+#define SHCODEBOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "VertexConverter.h"
+
+// Full-precision splat whose SH bands 1-3 are replaced by an index into an ShCodebook.
+// Decoded on the GPU by shaders/splat_storage.glsl (SH_CODEBOOK_SPLATS).
+struct CodebookSplat {
+    glm::vec4 position;
+    glm::vec4 scale_opacity;
+    glm::vec4 rotation;
+    float shDc[3];
+    uint16_t shIndex;
+    // keeps the record at 64 bytes, always 0
+    uint16_t padding;
+};
+
+static_assert(sizeof(CodebookSplat) == 64, "CodebookSplat must match shaders/splat_storage.glsl");
+
+// Vector quantizer for the 45 higher-order SH coefficients of a splat, trained with k-means at import time
+class ShCodebook {
+public:
+    static constexpr size_t REST_COEFFICIENTS = 45;
+    static constexpr size_t SIZE = 4096;
+    static_assert(SIZE <= (1u << 16), "codebook indices are 16 bit");
+    // training cost is samples * SIZE per iteration, so the training set is a fixed multiple of the codebook
+    static constexpr size_t SAMPLES_PER_ENTRY = 16;
+    static constexpr int ITERATIONS = 8;
+
+    // Lloyd's k-means on WorkerPool::shared(). `samples` holds numSamples * REST_COEFFICIENTS floats.
+    // The codebook has min(SIZE, numSamples) entries; training is deterministic.
+    static ShCodebook train(const std::vector<float> & samples);
+
+    // index of the closest entry (squared L2)
+    uint32_t nearest(const float * rest) const;
+
+    void encode(const SplatVertex * src, size_t count, CodebookSplat * dst) const;
+
+    // the splat as the GPU sees it
+    SplatVertex decode(const CodebookSplat & splat) const;
+
+    size_t size() const { return entries.size() / REST_COEFFICIENTS; }
+
+    // size() * REST_COEFFICIENTS floats, the GPU buffer content
+    const std::vector<float> & data() const { return entries; }
+
+    // mean squared coefficient error over the training set at the last assignment
+    double getTrainingError() const { return trainingError; }
+
+private:
+    std::vector<float> entries;
+    // entries rearranged for nearest(), see buildSearchLayout
+    std::vector<float> searchGroups;
+    double trainingError = 0.0;
+};
+
+#endif //SHCODEBOOK_H
@@ -0,0 +1,221 @@
+#include "SplatCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr float SQRT2 = 1.4142135623730951f;
+
+uint32_t quantize(float value, float min, float extent, uint32_t levels) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    float t = std::clamp((value - min) / extent, 0.0f, 1.0f);
+    return static_cast<uint32_t>(std::lround(t * levels));
+}
+
+float dequantize(uint32_t q, float min, float extent, uint32_t levels) {
+    return min + static_cast<float>(q) / levels * extent;
+}
+
+// same basis and constants as compute_sh in preprocess.glsl
+glm::vec3 evaluateSh(const float *sh, glm::vec3 dir) {
+    auto coefficient = [&](int i) { return glm::vec3(sh[i * 3], sh[i * 3 + 1], sh[i * 3 + 2]); };
+    const float C0 = 0.28209479177387814f;
+    const float C1 = 0.4886025119029199f;
+    const float C2[] = {1.0925484305920792f, -1.0925484305920792f, 0.31539156525252005f, -1.0925484305920792f,
+                        0.5462742152960396f};
+    const float C3[] = {-0.5900435899266435f, 2.890611442640554f, -0.4570457994644658f, 0.3731763325901154f,
+                        -0.4570457994644658f, 1.445305721320277f, -0.5900435899266435f};
+    float x = dir.x, y = dir.y, z = dir.z;
+
+    glm::vec3 c = C0 * coefficient(0);
+    c -= C1 * coefficient(1) * y;
+    c += C1 * coefficient(2) * z;
+    c -= C1 * coefficient(3) * x;
+
+    c += C2[0] * coefficient(4) * x * y;
+    c += C2[1] * coefficient(5) * y * z;
+    c += C2[2] * coefficient(6) * (2.0f * z * z - x * x - y * y);
+    c += C2[3] * coefficient(7) * z * x;
+    c += C2[4] * coefficient(8) * (x * x - y * y);
+
+    c += C3[0] * coefficient(9) * (3.0f * x * x - y * y) * y;
+    c += C3[1] * coefficient(10) * x * y * z;
+    c += C3[2] * coefficient(11) * (4.0f * z * z - x * x - y * y) * y;
+    c += C3[3] * coefficient(12) * z * (2.0f * z * z - 3.0f * x * x - 3.0f * y * y);
+    c += C3[4] * coefficient(13) * x * (4.0f * z * z - x * x - y * y);
+    c += C3[5] * coefficient(14) * (x * x - y * y) * z;
+    c += C3[6] * coefficient(15) * x * (x * x - 3.0f * y * y);
+
+    return glm::clamp(c + 0.5f, 0.0f, 1.0f);
+}
+
+} // namespace
+
+SplatChunk SplatCompression::compressChunk(const SplatVertex *src, size_t count, CompressedSplat *dst) {
+    glm::vec3 positionMin(std::numeric_limits<float>::max()), positionMax(std::numeric_limits<float>::lowest());
+    glm::vec3 scaleMin(std::numeric_limits<float>::max()), scaleMax(std::numeric_limits<float>::lowest());
+    glm::vec2 shMin(std::numeric_limits<float>::max()), shMax(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < count; i++) {
+        const SplatVertex &v = src[i];
+        glm::vec3 logScale = glm::log(glm::vec3(v.scale_opacity));
+        positionMin = glm::min(positionMin, glm::vec3(v.position));
+        positionMax = glm::max(positionMax, glm::vec3(v.position));
+        scaleMin = glm::min(scaleMin, logScale);
+        scaleMax = glm::max(scaleMax, logScale);
+        for (int k = 0; k < 48; k++) {
+            int band = k < 3 ? 0 : 1;
+            shMin[band] = std::min(shMin[band], v.shs[k]);
+            shMax[band] = std::max(shMax[band], v.shs[k]);
+        }
+    }
+
+    SplatChunk chunk{};
+    chunk.positionMin = glm::vec4(positionMin, 0.0f);
+    chunk.positionExtent = glm::vec4(positionMax - positionMin, 0.0f);
+    chunk.scaleMin = glm::vec4(scaleMin, 0.0f);
+    chunk.scaleExtent = glm::vec4(scaleMax - scaleMin, 0.0f);
+    chunk.shMin = glm::vec4(shMin, 0.0f, 0.0f);
+    chunk.shExtent = glm::vec4(shMax - shMin, 0.0f, 0.0f);
+
+    for (size_t i = 0; i < count; i++) {
+        const SplatVertex &v = src[i];
+        CompressedSplat &out = dst[i];
+
+        uint32_t position[3];
+        for (int axis = 0; axis < 3; axis++) {
+            position[axis] = quantize(v.position[axis], chunk.positionMin[axis], chunk.positionExtent[axis], 65535);
+        }
+        uint32_t opacity = quantize(v.scale_opacity.w, 0.0f, 1.0f, 255);
+        out.data[0] = position[0] | position[1] << 16;
+        out.data[1] = position[2] | opacity << 16;
+
+        glm::vec3 logScale = glm::log(glm::vec3(v.scale_opacity));
+        out.data[2] = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            out.data[2] |= quantize(logScale[axis], chunk.scaleMin[axis], chunk.scaleExtent[axis], 255) << (8 * axis);
+        }
+
+        // smallest three: drop the largest component, flip the sign so it is positive and rebuild it on decode
+        glm::vec4 q = glm::normalize(v.rotation);
+        int largest = 0;
+        for (int c = 1; c < 4; c++) {
+            if (std::abs(q[c]) > std::abs(q[largest])) {
+                largest = c;
+            }
+        }
+        if (q[largest] < 0.0f) {
+            q = -q;
+        }
+        uint32_t rotation = static_cast<uint32_t>(largest) << 30;
+        for (int c = 0, slot = 0; c < 4; c++) {
+            if (c != largest) {
+                rotation |= quantize(q[c] / SQRT2 + 0.5f, 0.0f, 1.0f, 1023) << (10 * slot++);
+            }
+        }
+        out.data[3] = rotation;
+
+        for (int word = 0; word < 12; word++) {
+            out.data[4 + word] = 0;
+        }
+        for (int k = 0; k < 48; k++) {
+            int band = k < 3 ? 0 : 1;
+            out.data[4 + k / 4] |= quantize(v.shs[k], chunk.shMin[band], chunk.shExtent[band], 255) << (8 * (k % 4));
+        }
+    }
+    return chunk;
+}
+
+SplatVertex SplatCompression::decompress(const SplatChunk &chunk, const CompressedSplat &splat) {
+    SplatVertex v{};
+    uint32_t position[3] = {splat.data[0] & 0xffffu, splat.data[0] >> 16, splat.data[1] & 0xffffu};
+    for (int axis = 0; axis < 3; axis++) {
+        v.position[axis] = dequantize(position[axis], chunk.positionMin[axis], chunk.positionExtent[axis], 65535);
+        uint32_t scale = (splat.data[2] >> (8 * axis)) & 0xffu;
+        v.scale_opacity[axis] = std::exp(dequantize(scale, chunk.scaleMin[axis], chunk.scaleExtent[axis], 255));
+    }
+    v.position.w = 1.0f;
+    v.scale_opacity.w = dequantize((splat.data[1] >> 16) & 0xffu, 0.0f, 1.0f, 255);
+
+    uint32_t rotation = splat.data[3];
+    int largest = static_cast<int>(rotation >> 30);
+    float sumSquares = 0.0f;
+    for (int c = 0, slot = 0; c < 4; c++) {
+        if (c != largest) {
+            float component = (dequantize((rotation >> (10 * slot++)) & 0x3ffu, 0.0f, 1.0f, 1023) - 0.5f) * SQRT2;
+            v.rotation[c] = component;
+            sumSquares += component * component;
+        }
+    }
+    v.rotation[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+
+    for (int k = 0; k < 48; k++) {
+        int band = k < 3 ? 0 : 1;
+        uint32_t q = (splat.data[4 + k / 4] >> (8 * (k % 4))) & 0xffu;
+        v.shs[k] = dequantize(q, chunk.shMin[band], chunk.shExtent[band], 255);
+    }
+    return v;
+}
+
+HalfSplat SplatCompression::toHalf(const SplatVertex &splat) {
+    HalfSplat out{};
+    for (int axis = 0; axis < 3; axis++) {
+        out.position[axis] = splat.position[axis];
+        out.scale[axis] = floatToHalf(splat.scale_opacity[axis]);
+    }
+    out.opacity = floatToHalf(splat.scale_opacity.w);
+    for (int c = 0; c < 4; c++) {
+        out.rotation[c] = floatToHalf(splat.rotation[c]);
+    }
+    for (int k = 0; k < 48; k++) {
+        out.shs[k] = floatToHalf(splat.shs[k]);
+    }
+    return out;
+}
+
+SplatVertex SplatCompression::fromHalf(const HalfSplat &splat) {
+    SplatVertex v{};
+    for (int axis = 0; axis < 3; axis++) {
+        v.position[axis] = splat.position[axis];
+        v.scale_opacity[axis] = halfToFloat(splat.scale[axis]);
+    }
+    v.position.w = 1.0f;
+    v.scale_opacity.w = halfToFloat(splat.opacity);
+    for (int c = 0; c < 4; c++) {
+        v.rotation[c] = halfToFloat(splat.rotation[c]);
+    }
+    for (int k = 0; k < 48; k++) {
+        v.shs[k] = halfToFloat(splat.shs[k]);
+    }
+    return v;
+}
+
+void SplatCompression::ColorError::add(const SplatVertex &original, const SplatVertex &decoded) {
+    // the eight octant diagonals cover every sign combination of the SH basis
+    static const glm::vec3 directions[8] = {
+            glm::normalize(glm::vec3(1, 1, 1)), glm::normalize(glm::vec3(1, 1, -1)),
+            glm::normalize(glm::vec3(1, -1, 1)), glm::normalize(glm::vec3(1, -1, -1)),
+            glm::normalize(glm::vec3(-1, 1, 1)), glm::normalize(glm::vec3(-1, 1, -1)),
+            glm::normalize(glm::vec3(-1, -1, 1)), glm::normalize(glm::vec3(-1, -1, -1)),
+    };
+    for (const auto &dir: directions) {
+        glm::vec3 diff = evaluateSh(original.shs, dir) - evaluateSh(decoded.shs, dir);
+        sumSquaredError += glm::dot(diff, diff);
+        numSamples += 3;
+    }
+}
+
+void SplatCompression::ColorError::merge(const ColorError &other) {
+    sumSquaredError += other.sumSquaredError;
+    numSamples += other.numSamples;
+}
+
+double SplatCompression::ColorError::psnr() const {
+    if (numSamples == 0 || sumSquaredError == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return -10.0 * std::log10(sumSquaredError / numSamples);
+}
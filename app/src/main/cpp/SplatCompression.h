@@ -0,0 +1,68 @@
+#ifndef SPLATCOMPRESSION_H
+#define SPLATCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "VertexConverter.h"
+
+// Quantized resident layout, decoded on the GPU by shaders/splat_storage.glsl (COMPRESSED_SPLATS).
+// See there for the bit layout.
+struct CompressedSplat {
+    uint32_t data[16];
+};
+
+// Quantization ranges of SplatCompression::CHUNK_SIZE consecutive splats
+struct SplatChunk {
+    glm::vec4 positionMin;
+    glm::vec4 positionExtent;
+    // natural log of the scales
+    glm::vec4 scaleMin;
+    glm::vec4 scaleExtent;
+    // x: band 0 (dc), y: higher bands
+    glm::vec4 shMin;
+    glm::vec4 shExtent;
+};
+
+// Half-precision layout (SplatStorage::HALF): positions stay fp32, everything else is binary16.
+// Matches HalfSplat in shaders/splat_storage.glsl (std430, 16 byte aligned).
+struct HalfSplat {
+    float position[3];
+    uint16_t opacity;
+    uint16_t padding0;
+    uint16_t rotation[4];
+    uint16_t scale[3];
+    uint16_t shs[48];
+    uint16_t padding1;
+};
+static_assert(sizeof(HalfSplat) == 128, "HalfSplat must match the std430 layout");
+
+namespace SplatCompression {
+    constexpr size_t CHUNK_SIZE = 256;
+
+    // Quantizes up to CHUNK_SIZE splats that share one set of ranges
+    SplatChunk compressChunk(const SplatVertex * src, size_t count, CompressedSplat * dst);
+
+    // CPU mirror of the shader decode, used to measure the quantization error
+    SplatVertex decompress(const SplatChunk & chunk, const CompressedSplat & splat);
+
+    HalfSplat toHalf(const SplatVertex & splat);
+
+    SplatVertex fromHalf(const HalfSplat & splat);
+
+    // Squared color error of view-dependent colors (SH evaluated along fixed directions, clamped to [0, 1])
+    struct ColorError {
+        double sumSquaredError = 0.0;
+        size_t numSamples = 0;
+
+        void add(const SplatVertex & original, const SplatVertex & decoded);
+
+        void merge(const ColorError & other);
+
+        // infinity when nothing was lost
+        double psnr() const;
+    };
+}
+
+#endif //SPLATCOMPRESSION_H
@@ -0,0 +1,338 @@
+#include "SplatFormats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+
+constexpr float SH_C0 = 0.28209479177387814f;
+
+template<typename T>
+T read(const void * p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// RGBA8 as written by the web viewers: rgb = 0.5 + SH_C0 * dc, alpha = sigmoid(opacity)
+void decodeColor(const uint8_t * rgba, SplatVertex & out) {
+    for (int c = 0; c < 3; c++) {
+        out.shs[c] = (rgba[c] / 255.0f - 0.5f) / SH_C0;
+    }
+    out.scale_opacity.w = rgba[3] / 255.0f;
+}
+
+size_t shRestComponents(int degree) {
+    return 3 * (shCoefficientCount(degree) - 1);
+}
+
+} // namespace
+
+// --- .splat
+
+AntimatterSplatSource::AntimatterSplatSource(const MappedAsset & asset) : body(asset.data()) {
+    constexpr size_t SPLAT_SIZE = 32;
+    if (asset.size() % SPLAT_SIZE != 0) {
+        throw std::runtime_error(".splat size is not a multiple of 32 bytes: " + asset.getName());
+    }
+    count = asset.size() / SPLAT_SIZE;
+    shDegree = 0;
+}
+
+std::string AntimatterSplatSource::describe() const {
+    return ".splat, 32 bytes per splat, SH degree 0";
+}
+
+void AntimatterSplatSource::decode(size_t begin, size_t n, SplatVertex * out) const {
+    for (size_t i = 0; i < n; i++) {
+        const char * splat = body + (begin + i) * 32;
+        SplatVertex & v = out[i];
+        std::memset(v.shs, 0, sizeof(v.shs));
+        v.position = glm::vec4(read<float>(splat), read<float>(splat + 4), read<float>(splat + 8), 1.0f);
+        v.scale_opacity = glm::vec4(read<float>(splat + 12), read<float>(splat + 16), read<float>(splat + 20), 0.0f);
+        decodeColor(reinterpret_cast<const uint8_t *>(splat + 24), v);
+        auto * rotation = reinterpret_cast<const uint8_t *>(splat + 28);
+        v.rotation = glm::normalize(glm::vec4((rotation[0] - 128) / 128.0f, (rotation[1] - 128) / 128.0f,
+                                              (rotation[2] - 128) / 128.0f, (rotation[3] - 128) / 128.0f));
+    }
+}
+
+// --- .ksplat
+
+KsplatSource::KsplatSource(const MappedAsset & asset) {
+    constexpr size_t HEADER_SIZE = 4096;
+    constexpr size_t SECTION_HEADER_SIZE = 1024;
+    const char * file = asset.data();
+    if (asset.size() < HEADER_SIZE) {
+        throw std::runtime_error(".ksplat is shorter than its header: " + asset.getName());
+    }
+    auto versionMajor = static_cast<uint8_t>(file[0]);
+    auto versionMinor = static_cast<uint8_t>(file[1]);
+    if (versionMajor != 0 || versionMinor < 1) {
+        throw std::runtime_error(".ksplat version " + std::to_string(versionMajor) + "." +
+                                 std::to_string(versionMinor) + " is not supported");
+    }
+    auto maxSectionCount = read<uint32_t>(file + 4);
+    auto sectionCount = read<uint32_t>(file + 8);
+    compressionLevel = read<uint16_t>(file + 20);
+    if (compressionLevel > 2 || sectionCount > maxSectionCount) {
+        throw std::runtime_error(".ksplat header is invalid: " + asset.getName());
+    }
+    float headerShMin = read<float>(file + 36), headerShMax = read<float>(file + 40);
+    if (headerShMin != 0.0f || headerShMax != 0.0f) {
+        shMin = headerShMin;
+        shMax = headerShMax;
+    }
+
+    const size_t positionBytes = compressionLevel == 0 ? 12 : 6;
+    const size_t scaleBytes = compressionLevel == 0 ? 12 : 6;
+    const size_t rotationBytes = compressionLevel == 0 ? 16 : 8;
+    const size_t shComponentBytes = compressionLevel == 0 ? 4 : compressionLevel == 1 ? 2 : 1;
+
+    size_t sectionBase = HEADER_SIZE + maxSectionCount * SECTION_HEADER_SIZE;
+    if (sectionBase > asset.size()) {
+        throw std::runtime_error(".ksplat section headers are truncated: " + asset.getName());
+    }
+    for (uint32_t s = 0; s < sectionCount; s++) {
+        const char * sectionHeader = file + HEADER_SIZE + s * SECTION_HEADER_SIZE;
+        Section section;
+        section.first = count;
+        section.count = read<uint32_t>(sectionHeader);
+        auto maxSplatCount = read<uint32_t>(sectionHeader + 4);
+        section.bucketSize = read<uint32_t>(sectionHeader + 8);
+        auto bucketCount = read<uint32_t>(sectionHeader + 12);
+        float bucketBlockSize = read<float>(sectionHeader + 16);
+        auto bucketStorageBytes = read<uint16_t>(sectionHeader + 20);
+        section.scaleRange = read<uint32_t>(sectionHeader + 24);
+        if (section.scaleRange == 0) {
+            section.scaleRange = compressionLevel == 0 ? 1 : 32767;
+        }
+        section.scaleFactor = bucketBlockSize / 2.0f / section.scaleRange;
+        section.fullBucketCount = read<uint32_t>(sectionHeader + 32);
+        auto partialBucketCount = read<uint32_t>(sectionHeader + 36);
+        section.shDegree = read<uint16_t>(sectionHeader + 40);
+        if (section.shDegree > 3 || section.count > maxSplatCount) {
+            throw std::runtime_error(".ksplat section header is invalid: " + asset.getName());
+        }
+        section.bytesPerSplat = positionBytes + scaleBytes + rotationBytes + 4 +
+                                shRestComponents(section.shDegree) * shComponentBytes;
+
+        size_t metadataBytes = partialBucketCount * sizeof(uint32_t);
+        size_t bucketBytes = metadataBytes + static_cast<size_t>(bucketStorageBytes) * bucketCount;
+        size_t sectionBytes = bucketBytes + section.bytesPerSplat * maxSplatCount;
+        if (sectionBase + sectionBytes > asset.size()) {
+            throw std::runtime_error(".ksplat section " + std::to_string(s) + " is truncated: " + asset.getName());
+        }
+        uint64_t bucketEnd = static_cast<uint64_t>(section.fullBucketCount) * section.bucketSize;
+        for (uint32_t b = 0; b < partialBucketCount; b++) {
+            bucketEnd += read<uint32_t>(file + sectionBase + b * sizeof(uint32_t));
+            section.partialBucketEnds.push_back(bucketEnd);
+        }
+        section.bucketCenters = file + sectionBase + metadataBytes;
+        section.data = file + sectionBase + bucketBytes;
+
+        sectionBase += sectionBytes;
+        count += section.count;
+        shDegree = std::max(shDegree, section.shDegree);
+        sections.push_back(std::move(section));
+    }
+}
+
+std::string KsplatSource::describe() const {
+    return ".ksplat, compression level " + std::to_string(compressionLevel) + ", " +
+           std::to_string(sections.size()) + " sections, SH degree " + std::to_string(shDegree);
+}
+
+void KsplatSource::decodeSplat(const Section & section, size_t local, SplatVertex & out) const {
+    const char * splat = section.data + local * section.bytesPerSplat;
+    std::memset(out.shs, 0, sizeof(out.shs));
+    size_t shComponents = shRestComponents(section.shDegree);
+    const char * shData;
+    if (compressionLevel == 0) {
+        out.position = glm::vec4(read<float>(splat), read<float>(splat + 4), read<float>(splat + 8), 1.0f);
+        out.scale_opacity = glm::vec4(read<float>(splat + 12), read<float>(splat + 16), read<float>(splat + 20), 0.0f);
+        out.rotation = glm::vec4(read<float>(splat + 24), read<float>(splat + 28), read<float>(splat + 32),
+                                 read<float>(splat + 36));
+        decodeColor(reinterpret_cast<const uint8_t *>(splat + 40), out);
+        shData = splat + 44;
+        for (size_t k = 0; k < shComponents; k++) {
+            out.shs[3 + k] = read<float>(shData + k * 4);
+        }
+    } else {
+        size_t bucket;
+        if (local < static_cast<size_t>(section.fullBucketCount) * section.bucketSize) {
+            bucket = local / section.bucketSize;
+        } else {
+            auto partial = std::upper_bound(section.partialBucketEnds.begin(), section.partialBucketEnds.end(), local);
+            bucket = section.fullBucketCount + (partial - section.partialBucketEnds.begin());
+        }
+        const char * center = section.bucketCenters + bucket * 3 * sizeof(float);
+        for (int axis = 0; axis < 3; axis++) {
+            float offset = static_cast<float>(read<uint16_t>(splat + axis * 2)) - static_cast<float>(section.scaleRange);
+            out.position[axis] = offset * section.scaleFactor + read<float>(center + axis * 4);
+            out.scale_opacity[axis] = halfToFloat(read<uint16_t>(splat + 6 + axis * 2));
+        }
+        out.position.w = 1.0f;
+        for (int c = 0; c < 4; c++) {
+            out.rotation[c] = halfToFloat(read<uint16_t>(splat + 12 + c * 2));
+        }
+        decodeColor(reinterpret_cast<const uint8_t *>(splat + 20), out);
+        shData = splat + 24;
+        for (size_t k = 0; k < shComponents; k++) {
+            if (compressionLevel == 1) {
+                out.shs[3 + k] = halfToFloat(read<uint16_t>(shData + k * 2));
+            } else {
+                out.shs[3 + k] = shMin + static_cast<uint8_t>(shData[k]) / 255.0f * (shMax - shMin);
+            }
+        }
+    }
+    out.rotation = glm::normalize(out.rotation);
+}
+
+void KsplatSource::decode(size_t begin, size_t n, SplatVertex * out) const {
+    auto section = std::upper_bound(sections.begin(), sections.end(), begin,
+                                    [](size_t index, const Section & s) { return index < s.first; }) - 1;
+    for (size_t i = 0; i < n; i++) {
+        size_t index = begin + i;
+        while (index >= section->first + section->count) {
+            ++section;
+        }
+        decodeSplat(*section, index - section->first, out[i]);
+    }
+}
+
+// --- .spz
+
+namespace {
+
+constexpr uint32_t SPZ_MAGIC = 0x5053474e; // "NGSP"
+constexpr size_t SPZ_HEADER_SIZE = 16;
+
+// sign of each SH basis function under (x, y, z) -> (x, -y, -z), in the order of compute_sh
+constexpr float SPZ_SH_FLIP[15] = {-1, -1, 1, -1, 1, 1, -1, 1, -1, 1, -1, -1, 1, -1, 1};
+
+void inflateInto(z_stream & stream, uint8_t * out, size_t size) {
+    stream.next_out = out;
+    stream.avail_out = static_cast<uInt>(size);
+    while (stream.avail_out > 0) {
+        int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END && stream.avail_out > 0) {
+            throw std::runtime_error(".spz stream ends early");
+        }
+        if (result != Z_OK && result != Z_STREAM_END) {
+            throw std::runtime_error(std::string(".spz inflate failed: ") + (stream.msg ? stream.msg : "unknown error"));
+        }
+    }
+}
+
+} // namespace
+
+SpzSource::SpzSource(const MappedAsset & asset) {
+    z_stream stream{};
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(asset.data()));
+    stream.avail_in = static_cast<uInt>(asset.size());
+    // 16 + MAX_WBITS: expect a gzip header
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        throw std::runtime_error(".spz: inflateInit2 failed");
+    }
+    try {
+        // the header gives the exact payload size, so the payload is allocated once and inflated in place
+        uint8_t header[SPZ_HEADER_SIZE];
+        inflateInto(stream, header, SPZ_HEADER_SIZE);
+        auto magic = read<uint32_t>(header);
+        version = read<uint32_t>(header + 4);
+        count = read<uint32_t>(header + 8);
+        shDegree = header[12];
+        fractionalBits = header[13];
+        if (magic != SPZ_MAGIC || version < 2 || version > 3 || shDegree > 3) {
+            throw std::runtime_error(".spz header is invalid or from an unsupported version: " + asset.getName());
+        }
+        shCoefficients = shCoefficientCount(shDegree) - 1;
+        size_t rotationBytes = version >= 3 ? 4 : 3;
+        size_t bytesPerSplat = 9 + 1 + 3 + 3 + rotationBytes + shCoefficients * 3;
+        payload.resize(count * bytesPerSplat);
+        inflateInto(stream, payload.data(), payload.size());
+    } catch (...) {
+        inflateEnd(&stream);
+        throw;
+    }
+    inflateEnd(&stream);
+    workingBytes = payload.size();
+
+    positions = payload.data();
+    alphas = positions + count * 9;
+    colors = alphas + count;
+    scales = colors + count * 3;
+    rotations = scales + count * 3;
+    sh = rotations + count * (version >= 3 ? 4 : 3);
+}
+
+std::string SpzSource::describe() const {
+    return ".spz v" + std::to_string(version) + ", SH degree " + std::to_string(shDegree) + ", " +
+           std::to_string(payload.size() / (1024 * 1024)) + " MB inflated";
+}
+
+void SpzSource::decode(size_t begin, size_t n, SplatVertex * out) const {
+    const float positionScale = 1.0f / static_cast<float>(1 << fractionalBits);
+    constexpr float SPZ_COLOR_SCALE = 0.15f;
+    constexpr float SQRT1_2 = 0.7071067811865476f;
+    for (size_t i = 0; i < n; i++) {
+        size_t index = begin + i;
+        SplatVertex & v = out[i];
+        std::memset(v.shs, 0, sizeof(v.shs));
+
+        const uint8_t * p = positions + index * 9;
+        for (int axis = 0; axis < 3; axis++) {
+            int32_t fixed = p[axis * 3] | p[axis * 3 + 1] << 8 | p[axis * 3 + 2] << 16;
+            // sign extend the 24-bit value
+            fixed = (fixed ^ 0x800000) - 0x800000;
+            v.position[axis] = static_cast<float>(fixed) * positionScale;
+            v.scale_opacity[axis] = std::exp(scales[index * 3 + axis] / 16.0f - 10.0f);
+            v.shs[axis] = (colors[index * 3 + axis] / 255.0f - 0.5f) / SPZ_COLOR_SCALE;
+        }
+        v.position.w = 1.0f;
+        v.scale_opacity.w = alphas[index] / 255.0f;
+
+        // spz quaternions are (x, y, z, w)
+        float q[4];
+        if (version >= 3) {
+            // smallest three: index of the largest component in the top 2 bits, then 3 x (9 bit magnitude, sign)
+            uint32_t packed = read<uint32_t>(rotations + index * 4);
+            int largest = static_cast<int>(packed >> 30);
+            float sumSquares = 0.0f;
+            for (int c = 3; c >= 0; c--) {
+                if (c == largest) {
+                    continue;
+                }
+                float magnitude = SQRT1_2 * static_cast<float>(packed & 511u) / 511.0f;
+                q[c] = (packed >> 9) & 1u ? -magnitude : magnitude;
+                sumSquares += q[c] * q[c];
+                packed >>= 10;
+            }
+            q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+        } else {
+            const uint8_t * r = rotations + index * 3;
+            float sumSquares = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                q[c] = r[c] / 127.5f - 1.0f;
+                sumSquares += q[c] * q[c];
+            }
+            q[3] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+        }
+
+        const uint8_t * coefficients = sh + index * shCoefficients * 3;
+        for (size_t k = 0; k < shCoefficients; k++) {
+            for (int c = 0; c < 3; c++) {
+                v.shs[3 + k * 3 + c] = SPZ_SH_FLIP[k] * (coefficients[k * 3 + c] - 128.0f) / 128.0f;
+            }
+        }
+
+        // right-up-back to the PLY convention is a 180 degree turn around x: negate y and z
+        v.position.y = -v.position.y;
+        v.position.z = -v.position.z;
+        v.rotation = glm::normalize(glm::vec4(q[3], q[0], -q[1], -q[2]));
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SPLATFORMATS_H
+#define SPLATFORMATS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "SplatSource.h"
+
+// antimatter15 .splat: 32 bytes per splat and no header. Float position and linear scale, RGBA8 color
+// (band 0 SH and sigmoid opacity), quaternion as 4 x uint8 (w first). No higher SH bands.
+class AntimatterSplatSource : public SplatSource {
+public:
+    explicit AntimatterSplatSource(const MappedAsset & asset);
+
+    std::string describe() const override;
+
+    void decode(size_t begin, size_t n, SplatVertex * out) const override;
+
+private:
+    const char * body;
+};
+
+// GaussianSplats3D .ksplat (format 0.1+): a 4 KB header, 1 KB per section header, then per section the bucket
+// metadata followed by fixed-size splat records. Compression levels 1 and 2 store positions as 16-bit
+// offsets from their bucket center and everything else as halves (SH as uint8 at level 2).
+class KsplatSource : public SplatSource {
+public:
+    explicit KsplatSource(const MappedAsset & asset);
+
+    std::string describe() const override;
+
+    void decode(size_t begin, size_t n, SplatVertex * out) const override;
+
+private:
+    struct Section {
+        // index of the first splat of the section in the scene
+        size_t first = 0;
+        size_t count = 0;
+        size_t bytesPerSplat = 0;
+        int shDegree = 0;
+        uint32_t bucketSize = 0;
+        uint32_t fullBucketCount = 0;
+        // section-relative end index of each partially filled bucket, those follow the full buckets
+        std::vector<uint64_t> partialBucketEnds;
+        const char * bucketCenters = nullptr;
+        uint32_t scaleRange = 1;
+        float scaleFactor = 0.0f;
+        const char * data = nullptr;
+    };
+
+    void decodeSplat(const Section & section, size_t local, SplatVertex & out) const;
+
+    std::vector<Section> sections;
+    int compressionLevel = 0;
+    float shMin = -1.5f;
+    float shMax = 1.5f;
+};
+
+// Niantic .spz (versions 2 and 3): a gzip stream with a 16 byte header followed by one column per attribute
+// (24-bit fixed point positions, uint8 opacity / color / log scale, 3 or 4 byte rotations, uint8 SH).
+// The stream is inflated once; spz stores right-up-back axes, which are flipped to the PLY convention.
+class SpzSource : public SplatSource {
+public:
+    explicit SpzSource(const MappedAsset & asset);
+
+    std::string describe() const override;
+
+    void decode(size_t begin, size_t n, SplatVertex * out) const override;
+
+private:
+    std::vector<uint8_t> payload;
+    uint32_t version = 0;
+    int fractionalBits = 0;
+    size_t shCoefficients = 0;
+    const uint8_t * positions = nullptr;
+    const uint8_t * alphas = nullptr;
+    const uint8_t * colors = nullptr;
+    const uint8_t * scales = nullptr;
+    const uint8_t * rotations = nullptr;
+    const uint8_t * sh = nullptr;
+};
+
+#endif //SPLATFORMATS_H
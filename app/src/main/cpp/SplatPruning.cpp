@@ -0,0 +1,216 @@
+#include "SplatPruning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "WorkerPool.h"
+
+namespace {
+
+enum Verdict : uint8_t {
+    KEEP,
+    LOW_OPACITY,
+    SMALL_VOLUME,
+    FLOATER,
+};
+
+constexpr uint32_t GRID_BITS = 21;
+constexpr uint32_t GRID_MAX = (1u << GRID_BITS) - 1;
+
+struct Grid {
+    glm::vec3 origin{0.0f};
+    float cellSize = 1.0f;
+    // (cell key, splat), sorted by key
+    std::vector<std::pair<uint64_t, uint32_t>> cells;
+
+    glm::uvec3 cellOf(const glm::vec3 & position) const {
+        glm::vec3 cell = glm::clamp((position - origin) / cellSize, 0.0f, static_cast<float>(GRID_MAX));
+        return glm::uvec3(cell);
+    }
+
+    static uint64_t key(const glm::uvec3 & cell) {
+        return cell.x | static_cast<uint64_t>(cell.y) << GRID_BITS | static_cast<uint64_t>(cell.z) << (2 * GRID_BITS);
+    }
+};
+
+// Sorts the candidates into cells of about `neighbors` splats each. The first guess assumes a uniform density,
+// later passes correct it by the occupancy found; splats mostly lie on surfaces, which fill cells as the square
+// of their size.
+Grid buildGrid(const std::vector<glm::vec3> & positions, const std::vector<uint32_t> & candidates, uint32_t neighbors) {
+    constexpr int PASSES = 3;
+    Grid grid;
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t splat: candidates) {
+        boundsMin = glm::min(boundsMin, positions[splat]);
+        boundsMax = glm::max(boundsMax, positions[splat]);
+    }
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+    float maxExtent = std::max({extent.x, extent.y, extent.z});
+    grid.origin = boundsMin;
+    grid.cellSize = std::cbrt(extent.x * extent.y * extent.z * neighbors / candidates.size());
+
+    grid.cells.resize(candidates.size());
+    for (int pass = 0; pass < PASSES; pass++) {
+        grid.cellSize = std::max(grid.cellSize, maxExtent / GRID_MAX);
+        WorkerPool::shared().parallelFor(candidates.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                grid.cells[i] = {Grid::key(grid.cellOf(positions[candidates[i]])), candidates[i]};
+            }
+        }, 16384);
+        std::sort(grid.cells.begin(), grid.cells.end());
+
+        size_t occupied = 0;
+        for (size_t i = 0; i < grid.cells.size(); i++) {
+            occupied += i == 0 || grid.cells[i].first != grid.cells[i - 1].first;
+        }
+        float occupancy = static_cast<float>(grid.cells.size()) / occupied;
+        if (pass == PASSES - 1 || (occupancy >= 0.5f * neighbors && occupancy <= 2.0f * neighbors)) {
+            break;
+        }
+        grid.cellSize *= std::sqrt(neighbors / occupancy);
+    }
+    return grid;
+}
+
+// Distance of each candidate to its k-th nearest neighbor within the 27 surrounding cells, infinite when fewer
+// than k splats are that close
+std::vector<float> kthNeighborDistances(const std::vector<glm::vec3> & positions,
+                                        const std::vector<uint32_t> & candidates, const Grid & grid, uint32_t k) {
+    std::vector<float> distances(candidates.size());
+    WorkerPool::shared().parallelFor(candidates.size(), [&](size_t begin, size_t end) {
+        std::vector<float> squared;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t splat = candidates[i];
+            glm::vec3 position = positions[splat];
+            glm::ivec3 center(grid.cellOf(position));
+            squared.clear();
+            for (int dz = -1; dz <= 1; dz++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        glm::ivec3 cell = center + glm::ivec3(dx, dy, dz);
+                        if (glm::any(glm::lessThan(cell, glm::ivec3(0))) ||
+                            glm::any(glm::greaterThan(cell, glm::ivec3(GRID_MAX)))) {
+                            continue;
+                        }
+                        uint64_t key = Grid::key(glm::uvec3(cell));
+                        auto it = std::lower_bound(grid.cells.begin(), grid.cells.end(),
+                                                   std::make_pair(key, uint32_t(0)));
+                        for (; it != grid.cells.end() && it->first == key; ++it) {
+                            if (it->second != splat) {
+                                glm::vec3 d = positions[it->second] - position;
+                                squared.push_back(glm::dot(d, d));
+                            }
+                        }
+                    }
+                }
+            }
+            if (squared.size() < k) {
+                distances[i] = std::numeric_limits<float>::infinity();
+                continue;
+            }
+            std::nth_element(squared.begin(), squared.begin() + (k - 1), squared.end());
+            distances[i] = std::sqrt(squared[k - 1]);
+        }
+    }, 4096);
+    return distances;
+}
+
+void markFloaters(const std::vector<glm::vec3> & positions, std::vector<uint8_t> & verdicts,
+                  const PruneOptions & options) {
+    std::vector<uint32_t> candidates;
+    for (size_t splat = 0; splat < verdicts.size(); splat++) {
+        if (verdicts[splat] == KEEP) {
+            candidates.push_back(static_cast<uint32_t>(splat));
+        }
+    }
+    uint32_t k = options.floaterNeighbors;
+    if (candidates.size() <= k) {
+        return;
+    }
+
+    Grid grid = buildGrid(positions, candidates, k);
+    std::vector<float> distances = kthNeighborDistances(positions, candidates, grid, k);
+
+    std::vector<float> finite;
+    finite.reserve(distances.size());
+    for (float distance: distances) {
+        if (std::isfinite(distance)) {
+            finite.push_back(distance);
+        }
+    }
+    if (finite.empty()) {
+        // nothing is denser than any other splat, there is no scene to float away from
+        return;
+    }
+    std::nth_element(finite.begin(), finite.begin() + finite.size() / 2, finite.end());
+    float threshold = options.floaterDistanceFactor * finite[finite.size() / 2];
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (distances[i] > threshold) {
+            verdicts[candidates[i]] = FLOATER;
+        }
+    }
+}
+
+} // namespace
+
+namespace SplatPruning {
+
+bool isEnabled(const PruneOptions & options) {
+    return options.minOpacity > 0.0f || options.minVolume > 0.0f ||
+           (options.floaterDistanceFactor > 0.0f && options.floaterNeighbors > 0);
+}
+
+std::vector<uint32_t> select(const SplatSource & source, const PruneOptions & options, Report & report) {
+    constexpr size_t BLOCK_SIZE = 1024;
+    constexpr float ELLIPSOID_VOLUME = 4.0f / 3.0f * 3.14159265f;
+    size_t count = source.getCount();
+    std::vector<glm::vec3> positions(count);
+    std::vector<uint8_t> verdicts(count, KEEP);
+    WorkerPool::shared().parallelFor(count, [&](size_t begin, size_t end) {
+        std::vector<SplatVertex> block(BLOCK_SIZE);
+        for (size_t first = begin; first < end; first += BLOCK_SIZE) {
+            size_t n = std::min(BLOCK_SIZE, end - first);
+            source.decode(first, n, block.data());
+            for (size_t i = 0; i < n; i++) {
+                // opacity is sigmoid and scales linear after decode
+                const auto & scaleOpacity = block[i].scale_opacity;
+                positions[first + i] = glm::vec3(block[i].position);
+                if (scaleOpacity.w < options.minOpacity) {
+                    verdicts[first + i] = LOW_OPACITY;
+                } else if (ELLIPSOID_VOLUME * scaleOpacity.x * scaleOpacity.y * scaleOpacity.z < options.minVolume) {
+                    verdicts[first + i] = SMALL_VOLUME;
+                }
+            }
+        }
+    }, 16384);
+
+    if (options.floaterDistanceFactor > 0.0f && options.floaterNeighbors > 0) {
+        markFloaters(positions, verdicts, options);
+    }
+
+    report = Report{};
+    report.total = count;
+    std::vector<uint32_t> kept;
+    kept.reserve(count);
+    for (size_t splat = 0; splat < count; splat++) {
+        switch (verdicts[splat]) {
+            case LOW_OPACITY:
+                report.lowOpacity++;
+                break;
+            case SMALL_VOLUME:
+                report.smallVolume++;
+                break;
+            case FLOATER:
+                report.floaters++;
+                break;
+            default:
+                kept.push_back(static_cast<uint32_t>(splat));
+        }
+    }
+    return kept;
+}
+
+} // namespace SplatPruning
@@ -0,0 +1,31 @@
+#ifndef SPLATPRUNING_H
+#define SPLATPRUNING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base_utils.h"
+#include "SplatSource.h"
+
+// Drops splats that cost a preprocess invocation every frame but add little or nothing to the image:
+// near-transparent ones, tiny ones and isolated floaters far from the rest of the scene
+namespace SplatPruning {
+    struct Report {
+        size_t total = 0;
+        // each splat is counted under the first test it fails, in this order
+        size_t lowOpacity = 0;
+        size_t smallVolume = 0;
+        size_t floaters = 0;
+
+        size_t removed() const { return lowOpacity + smallVolume + floaters; }
+    };
+
+    bool isEnabled(const PruneOptions & options);
+
+    // Indices of the splats that pass every enabled test, ascending. Floaters are found with the distance to the
+    // k-th nearest neighbor on a uniform grid: exact up to one cell, an upper bound beyond that.
+    std::vector<uint32_t> select(const SplatSource & source, const PruneOptions & options, Report & report);
+}
+
+#endif //SPLATPRUNING_H
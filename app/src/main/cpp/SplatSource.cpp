@@ -0,0 +1,215 @@
+#include "SplatSource.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "RadixSort.h"
+#include "SplatFormats.h"
+#include "WorkerPool.h"
+
+namespace {
+
+std::string lowerExtension(const std::string & name) {
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos) {
+        return "";
+    }
+    std::string extension = name.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+} // namespace
+
+std::unique_ptr<SplatSource> SplatSource::open(const MappedAsset & asset) {
+    std::string extension = lowerExtension(asset.getName());
+    if (extension.empty() || (extension != "ply" && extension != "splat" && extension != "ksplat" &&
+                              extension != "spz")) {
+        // sniff the content: PLY starts with its magic line, spz is a gzip stream
+        std::string_view content = asset.view();
+        if (content.substr(0, 4) == "ply\n" || content.substr(0, 5) == "ply\r\n") {
+            extension = "ply";
+        } else if (content.size() >= 2 && static_cast<uint8_t>(content[0]) == 0x1f &&
+                   static_cast<uint8_t>(content[1]) == 0x8b) {
+            extension = "spz";
+        } else {
+            throw std::runtime_error("Unknown scene format: " + asset.getName());
+        }
+    }
+
+    if (extension == "splat") {
+        return std::make_unique<AntimatterSplatSource>(asset);
+    } else if (extension == "ksplat") {
+        return std::make_unique<KsplatSource>(asset);
+    } else if (extension == "spz") {
+        return std::make_unique<SpzSource>(asset);
+    }
+    return std::make_unique<PlySplatSource>(asset);
+}
+
+void SplatSource::computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const {
+    constexpr size_t BLOCK_SIZE = 1024;
+    std::mutex mutex;
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    WorkerPool::shared().parallelFor(count, [&](size_t begin, size_t end) {
+        std::vector<SplatVertex> block(BLOCK_SIZE);
+        glm::vec3 rangeMin(std::numeric_limits<float>::max());
+        glm::vec3 rangeMax(std::numeric_limits<float>::lowest());
+        for (size_t first = begin; first < end; first += BLOCK_SIZE) {
+            size_t n = std::min(BLOCK_SIZE, end - first);
+            decode(first, n, block.data());
+            for (size_t i = 0; i < n; i++) {
+                rangeMin = glm::min(rangeMin, glm::vec3(block[i].position));
+                rangeMax = glm::max(rangeMax, glm::vec3(block[i].position));
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        boundsMin = glm::min(boundsMin, rangeMin);
+        boundsMax = glm::max(boundsMax, rangeMax);
+    }, 16384);
+}
+
+ReorderedSplatSource::ReorderedSplatSource(std::unique_ptr<SplatSource> _source, std::vector<uint32_t> _order)
+    : source(std::move(_source)), order(std::move(_order)) {
+    if (order.size() > source->getCount()) {
+        throw std::runtime_error("Splat order is longer than the scene");
+    }
+    count = order.size();
+    shDegree = source->getShDegree();
+    workingBytes = source->getWorkingBytes() + order.size() * sizeof(uint32_t);
+}
+
+std::vector<uint32_t> ReorderedSplatSource::importanceOrder(const SplatSource & source) {
+    constexpr size_t BLOCK_SIZE = 1024;
+    std::vector<float> importance(source.getCount());
+    WorkerPool::shared().parallelFor(importance.size(), [&](size_t begin, size_t end) {
+        std::vector<SplatVertex> block(BLOCK_SIZE);
+        for (size_t first = begin; first < end; first += BLOCK_SIZE) {
+            size_t n = std::min(BLOCK_SIZE, end - first);
+            source.decode(first, n, block.data());
+            for (size_t i = 0; i < n; i++) {
+                // scales are linear after decode, the product of the two largest is the cross-section
+                glm::vec3 scale = glm::vec3(block[i].scale_opacity);
+                float smallest = std::min({scale.x, scale.y, scale.z});
+                float area = scale.x * scale.y * scale.z / std::max(smallest, 1e-12f);
+                importance[first + i] = block[i].scale_opacity.w * area;
+            }
+        }
+    }, 16384);
+
+    std::vector<uint32_t> order(importance.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    // ties keep file order so the result does not depend on the sort implementation
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return importance[a] > importance[b];
+    });
+    return order;
+}
+
+std::vector<uint32_t> ReorderedSplatSource::spatialOrder(const SplatSource & source, const glm::vec3 & boundsMin,
+                                                         const glm::vec3 & boundsMax) {
+    constexpr size_t BLOCK_SIZE = 1024;
+    // spreads the low 10 bits of v to every third bit
+    auto spread = [](uint32_t v) {
+        v = (v | (v << 16)) & 0x030000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    };
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+    std::vector<uint32_t> codes(source.getCount());
+    std::vector<uint32_t> order(codes.size());
+    WorkerPool::shared().parallelFor(codes.size(), [&](size_t begin, size_t end) {
+        std::vector<SplatVertex> block(BLOCK_SIZE);
+        for (size_t first = begin; first < end; first += BLOCK_SIZE) {
+            size_t n = std::min(BLOCK_SIZE, end - first);
+            source.decode(first, n, block.data());
+            for (size_t i = 0; i < n; i++) {
+                glm::vec3 cell = glm::clamp((glm::vec3(block[i].position) - boundsMin) / extent, 0.0f, 1.0f) * 1023.0f;
+                uint32_t code = spread(static_cast<uint32_t>(cell.x)) | spread(static_cast<uint32_t>(cell.y)) << 1 |
+                                spread(static_cast<uint32_t>(cell.z)) << 2;
+                codes[first + i] = code;
+                order[first + i] = static_cast<uint32_t>(first + i);
+            }
+        }
+    }, 16384);
+    // stable, ties keep file order
+    RadixSort::sortPairs(codes, order, 30);
+    return order;
+}
+
+std::string ReorderedSplatSource::describe() const {
+    return source->describe() + ", reordered";
+}
+
+void ReorderedSplatSource::decode(size_t begin, size_t n, SplatVertex * out) const {
+    // Keeps the source's batch kernel busy: a block whose indices fall in a narrow window (spatial order of a
+    // spatially sorted file, importance order within a cluster) is decoded as that window and permuted, the
+    // rest is decoded as runs of consecutive indices.
+    constexpr size_t blockSize = 256;
+    constexpr size_t maxWindow = 4 * blockSize;
+    std::vector<SplatVertex> window;
+    for (size_t first = 0; first < n; first += blockSize) {
+        const size_t blockEnd = std::min(n, first + blockSize);
+        const auto [lo, hi] = std::minmax_element(order.begin() + begin + first, order.begin() + begin + blockEnd);
+        const size_t span = static_cast<size_t>(*hi) - *lo + 1;
+        if (span <= maxWindow) {
+            window.resize(span);
+            source->decode(*lo, span, window.data());
+            for (size_t i = first; i < blockEnd; i++) {
+                out[i] = window[order[begin + i] - *lo];
+            }
+            continue;
+        }
+        for (size_t i = first; i < blockEnd;) {
+            size_t run = 1;
+            while (i + run < blockEnd && order[begin + i + run] == order[begin + i] + run) {
+                run++;
+            }
+            source->decode(order[begin + i], run, out + i);
+            i += run;
+        }
+    }
+}
+
+void ReorderedSplatSource::computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const {
+    if (count < source->getCount()) {
+        // a subset has bounds of its own
+        SplatSource::computeBounds(boundsMin, boundsMax);
+        return;
+    }
+    source->computeBounds(boundsMin, boundsMax);
+}
+
+PlySplatSource::PlySplatSource(const MappedAsset & asset)
+    : header(PlyHeader::parse(asset.view())), layout(PlyVertexLayout::fromHeader(header)) {
+    if (header.vertexOffset + static_cast<size_t>(header.numVertices) * layout.stride > asset.size()) {
+        throw std::runtime_error("PLY body is shorter than the header claims");
+    }
+    body = asset.data() + header.vertexOffset;
+    count = header.numVertices;
+    shDegree = layout.shDegree;
+}
+
+std::string PlySplatSource::describe() const {
+    return "PLY " + layout.describe();
+}
+
+void PlySplatSource::decode(size_t begin, size_t n, SplatVertex * out) const {
+    VertexConverter::convert(body + begin * layout.stride, layout, out, n);
+}
+
+void PlySplatSource::computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const {
+    VertexConverter::computeBounds(body, layout, count, boundsMin, boundsMax);
+}
@@ -0,0 +1,100 @@
+#ifndef SPLATSOURCE_H
+#define SPLATSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "MappedAsset.h"
+#include "PlyHeader.h"
+#include "VertexConverter.h"
+
+// Random-access decoder from a scene file into SplatVertex. GSScene streams every format through the
+// same staging path, so an importer only has to turn splat indices into vertices.
+// The source reads the mapped file in place, the asset has to outlive it.
+class SplatSource {
+public:
+    virtual ~SplatSource() = default;
+
+    // Picks the importer from the file extension (.ply, .splat, .ksplat, .spz), or from the content
+    // when the extension is unknown. Throws std::runtime_error for malformed files.
+    static std::unique_ptr<SplatSource> open(const MappedAsset & asset);
+
+    size_t getCount() const { return count; }
+
+    // SH degree stored in the file, higher bands decode as zero
+    int getShDegree() const { return shDegree; }
+
+    // host memory held besides the mapping, e.g. the inflated .spz payload
+    size_t getWorkingBytes() const { return workingBytes; }
+
+    virtual std::string describe() const = 0;
+
+    // Decodes splats [begin, begin + n); safe to call concurrently on disjoint ranges
+    virtual void decode(size_t begin, size_t n, SplatVertex * out) const = 0;
+
+    // Bounds of all positions; the default decodes every splat on WorkerPool::shared()
+    virtual void computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const;
+
+protected:
+    size_t count = 0;
+    int shDegree = 0;
+    size_t workingBytes = 0;
+};
+
+// Presents another source, or a subset of it, in a different order: splat i of this source is splat order[i] of
+// the wrapped one
+class ReorderedSplatSource : public SplatSource {
+public:
+    ReorderedSplatSource(std::unique_ptr<SplatSource> source, std::vector<uint32_t> order);
+
+    // Most important splats first: sigmoid opacity times the area of the largest cross-section of the
+    // ellipsoid, which is what a splat covers on screen at a given distance from any direction
+    static std::vector<uint32_t> importanceOrder(const SplatSource & source);
+
+    // Along a Morton curve over the given bounds (10 bits per axis), so that consecutive splats are close in space
+    static std::vector<uint32_t> spatialOrder(const SplatSource & source, const glm::vec3 & boundsMin,
+                                              const glm::vec3 & boundsMax);
+
+    std::string describe() const override;
+
+    void decode(size_t begin, size_t n, SplatVertex * out) const override;
+
+    void computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const override;
+
+    // file index of each splat, invert it to write splats back in file order
+    const std::vector<uint32_t> & getOrder() const { return order; }
+
+private:
+    std::unique_ptr<SplatSource> source;
+    std::vector<uint32_t> order;
+};
+
+// binary_little_endian PLY as written by the 3DGS training code
+class PlySplatSource : public SplatSource {
+public:
+    explicit PlySplatSource(const MappedAsset & asset);
+
+    std::string describe() const override;
+
+    void decode(size_t begin, size_t n, SplatVertex * out) const override;
+
+    void computeBounds(glm::vec3 & boundsMin, glm::vec3 & boundsMax) const override;
+
+    const PlyHeader & getHeader() const { return header; }
+
+    const PlyVertexLayout & getLayout() const { return layout; }
+
+    // first vertex record in the mapping, records are getLayout().stride bytes apart
+    const char * getRecords() const { return body; }
+
+private:
+    PlyHeader header;
+    PlyVertexLayout layout;
+    const char * body;
+};
+
+#endif //SPLATSOURCE_H
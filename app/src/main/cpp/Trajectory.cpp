@@ -0,0 +1,592 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "base_utils.h"
+
+namespace {
+
+bool endsWith(const std::string & s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::shared_ptr<MappedAsset> openMapped(AAssetManager * assetManager, const std::string & path) {
+    if (!path.empty() && path[0] == '/') {
+        auto mapped = MappedAsset::fromFile(path);
+        if (mapped == nullptr) {
+            throw std::runtime_error("Trajectory: cannot open " + path);
+        }
+        return mapped;
+    }
+    return MappedAsset::fromAsset(assetManager, path.c_str());
+}
+
+bool exists(AAssetManager * assetManager, const std::string & path) {
+    if (!path.empty() && path[0] == '/') {
+        return MappedAsset::fromFile(path) != nullptr;
+    }
+    AAsset * asset = AAssetManager_open(assetManager, path.c_str(), AASSET_MODE_UNKNOWN);
+    if (asset == nullptr) {
+        return false;
+    }
+    AAsset_close(asset);
+    return true;
+}
+
+// strtod needs a terminated string, numbers in these files are short
+double parseNumber(std::string_view token) {
+    char buffer[64];
+    if (token.empty() || token.size() >= sizeof(buffer)) {
+        throw std::runtime_error("Trajectory: malformed number '" + std::string(token) + "'");
+    }
+    std::memcpy(buffer, token.data(), token.size());
+    buffer[token.size()] = '\0';
+    char * end = nullptr;
+    double value = std::strtod(buffer, &end);
+    if (end != buffer + token.size()) {
+        throw std::runtime_error("Trajectory: malformed number '" + std::string(token) + "'");
+    }
+    return value;
+}
+
+void setIntrinsics(CameraPose & pose, double fx, double fy, double cx, double cy, uint64_t width, uint64_t height) {
+    pose.fx = static_cast<float>(fx);
+    pose.fy = static_cast<float>(fy);
+    pose.cx = static_cast<float>(cx);
+    pose.cy = static_cast<float>(cy);
+    pose.width = static_cast<uint32_t>(width);
+    pose.height = static_cast<uint32_t>(height);
+    if (fx > 0.0 && width > 0) {
+        pose.fovX = static_cast<float>(2.0 * std::atan(0.5 * static_cast<double>(width) / fx));
+    }
+}
+
+// camera-to-world with x right, y up, looking down -z: the renderer's own convention
+CameraPose fromOpenGl(const glm::mat3 & cameraToWorld, const glm::vec3 & position) {
+    CameraPose pose;
+    pose.position = position;
+    pose.rotation = glm::normalize(glm::quat_cast(cameraToWorld));
+    return pose;
+}
+
+// world-to-camera with x right, y down, looking down +z (COLMAP)
+CameraPose fromOpenCv(const glm::quat & worldToCamera, const glm::vec3 & translation) {
+    glm::mat3 cameraToWorld = glm::transpose(glm::mat3_cast(glm::normalize(worldToCamera)));
+    glm::vec3 position = -(cameraToWorld * translation);
+    // flipping y and z turns OpenCV camera axes into OpenGL ones
+    cameraToWorld[1] = -cameraToWorld[1];
+    cameraToWorld[2] = -cameraToWorld[2];
+    return fromOpenGl(cameraToWorld, position);
+}
+
+// Bounds-checked little-endian reads over a mapped binary file
+class BinaryReader {
+public:
+    BinaryReader(std::string_view data, std::string name) : data(data), name(std::move(name)) {}
+
+    template<typename T>
+    T read() {
+        T value;
+        require(sizeof(T));
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string_view readString() {
+        size_t end = data.find('\0', offset);
+        if (end == std::string_view::npos) {
+            throw std::runtime_error("Trajectory: unterminated string in " + name);
+        }
+        std::string_view s = data.substr(offset, end - offset);
+        offset = end + 1;
+        return s;
+    }
+
+    void skip(size_t bytes) {
+        require(bytes);
+        offset += bytes;
+    }
+
+private:
+    void require(size_t bytes) const {
+        if (bytes > data.size() - offset) {
+            throw std::runtime_error("Trajectory: " + name + " is truncated");
+        }
+    }
+
+    std::string_view data;
+    std::string name;
+    size_t offset = 0;
+};
+
+// Splits text into lines and lines into whitespace separated tokens without copying
+class TextReader {
+public:
+    explicit TextReader(std::string_view text) : text(text) {}
+
+    // false at the end of the text; empty lines are returned, they matter in images.txt
+    bool nextLine(std::string_view & line) {
+        if (offset >= text.size()) {
+            return false;
+        }
+        size_t end = text.find('\n', offset);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        line = text.substr(offset, end - offset);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        offset = end + 1;
+        return true;
+    }
+
+    static std::vector<std::string_view> tokens(std::string_view line) {
+        std::vector<std::string_view> result;
+        size_t begin = line.find_first_not_of(" \t");
+        while (begin != std::string_view::npos) {
+            size_t end = line.find_first_of(" \t", begin);
+            result.push_back(line.substr(begin, end == std::string_view::npos ? end : end - begin));
+            begin = end == std::string_view::npos ? end : line.find_first_not_of(" \t", end);
+        }
+        return result;
+    }
+
+private:
+    std::string_view text;
+    size_t offset = 0;
+};
+
+// The subset of JSON transforms files use; strings keep their escapes, only file names are strings
+struct JsonValue {
+    enum class Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT,
+    };
+
+    Type type = Type::NUL;
+    double number = 0.0;
+    std::string_view string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string_view, JsonValue>> members;
+
+    const JsonValue * find(std::string_view key) const {
+        for (const auto & member: members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    double numberOr(std::string_view key, double fallback) const {
+        const JsonValue * value = find(key);
+        return value != nullptr && value->type == Type::NUMBER ? value->number : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text(text) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (offset != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    [[noreturn]] void fail(const char * what) const {
+        throw std::runtime_error(std::string("Trajectory: malformed JSON, ") + what + " at offset " +
+                                 std::to_string(offset));
+    }
+
+    void skipWhitespace() {
+        while (offset < text.size() && std::strchr(" \t\r\n", text[offset]) != nullptr && text[offset] != '\0') {
+            offset++;
+        }
+    }
+
+    void expect(char c) {
+        skipWhitespace();
+        if (offset >= text.size() || text[offset] != c) {
+            fail("unexpected character");
+        }
+        offset++;
+    }
+
+    std::string_view parseString() {
+        expect('"');
+        size_t begin = offset;
+        while (offset < text.size() && text[offset] != '"') {
+            offset += text[offset] == '\\' ? 2 : 1;
+        }
+        if (offset >= text.size()) {
+            fail("unterminated string");
+        }
+        return text.substr(begin, offset++ - begin);
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > MAX_DEPTH) {
+            fail("nesting too deep");
+        }
+        skipWhitespace();
+        if (offset >= text.size()) {
+            fail("unexpected end");
+        }
+        JsonValue value;
+        char c = text[offset];
+        if (c == '{') {
+            value.type = JsonValue::Type::OBJECT;
+            offset++;
+            skipWhitespace();
+            if (offset < text.size() && text[offset] == '}') {
+                offset++;
+                return value;
+            }
+            do {
+                std::string_view key = parseString();
+                expect(':');
+                value.members.emplace_back(key, parseValue(depth + 1));
+                skipWhitespace();
+            } while (offset < text.size() && text[offset] == ',' && ++offset);
+            expect('}');
+        } else if (c == '[') {
+            value.type = JsonValue::Type::ARRAY;
+            offset++;
+            skipWhitespace();
+            if (offset < text.size() && text[offset] == ']') {
+                offset++;
+                return value;
+            }
+            do {
+                value.items.push_back(parseValue(depth + 1));
+                skipWhitespace();
+            } while (offset < text.size() && text[offset] == ',' && ++offset);
+            expect(']');
+        } else if (c == '"') {
+            value.type = JsonValue::Type::STRING;
+            value.string = parseString();
+        } else if (text.compare(offset, 4, "true") == 0 || text.compare(offset, 5, "false") == 0) {
+            value.type = JsonValue::Type::BOOLEAN;
+            value.number = c == 't' ? 1.0 : 0.0;
+            offset += c == 't' ? 4 : 5;
+        } else if (text.compare(offset, 4, "null") == 0) {
+            offset += 4;
+        } else {
+            size_t end = text.find_first_not_of("+-0123456789.eE", offset);
+            end = end == std::string_view::npos ? text.size() : end;
+            value.type = JsonValue::Type::NUMBER;
+            value.number = parseNumber(text.substr(offset, end - offset));
+            offset = end;
+        }
+        return value;
+    }
+
+    std::string_view text;
+    size_t offset = 0;
+};
+
+// parameters per COLMAP camera model id; models with a single focal length list it first
+struct ColmapModel {
+    const char * name;
+    size_t numParams;
+    bool singleFocal;
+};
+
+constexpr ColmapModel COLMAP_MODELS[] = {
+        {"SIMPLE_PINHOLE", 3, true},
+        {"PINHOLE", 4, false},
+        {"SIMPLE_RADIAL", 4, true},
+        {"RADIAL", 5, true},
+        {"OPENCV", 8, false},
+        {"OPENCV_FISHEYE", 8, false},
+        {"FULL_OPENCV", 12, false},
+        {"FOV", 5, false},
+        {"SIMPLE_RADIAL_FISHEYE", 4, true},
+        {"RADIAL_FISHEYE", 5, true},
+        {"THIN_PRISM_FISHEYE", 12, false},
+};
+
+struct ColmapCamera {
+    uint64_t width = 0;
+    uint64_t height = 0;
+    double fx = 0.0;
+    double fy = 0.0;
+    double cx = 0.0;
+    double cy = 0.0;
+};
+
+ColmapCamera makeColmapCamera(const ColmapModel & model, uint64_t width, uint64_t height,
+                              const std::vector<double> & params) {
+    ColmapCamera camera;
+    camera.width = width;
+    camera.height = height;
+    camera.fx = params[0];
+    camera.fy = model.singleFocal ? params[0] : params[1];
+    camera.cx = model.singleFocal ? params[1] : params[2];
+    camera.cy = model.singleFocal ? params[2] : params[3];
+    return camera;
+}
+
+std::unordered_map<uint32_t, ColmapCamera> readColmapCameras(const MappedAsset & cameras, bool binary) {
+    constexpr size_t NUM_MODELS = sizeof(COLMAP_MODELS) / sizeof(COLMAP_MODELS[0]);
+    std::unordered_map<uint32_t, ColmapCamera> result;
+    if (binary) {
+        BinaryReader reader(cameras.view(), cameras.getName());
+        auto count = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < count; i++) {
+            auto id = reader.read<uint32_t>();
+            auto modelId = reader.read<int32_t>();
+            if (modelId < 0 || static_cast<size_t>(modelId) >= NUM_MODELS) {
+                throw std::runtime_error("Trajectory: unknown COLMAP camera model " + std::to_string(modelId));
+            }
+            const ColmapModel & model = COLMAP_MODELS[modelId];
+            auto width = reader.read<uint64_t>();
+            auto height = reader.read<uint64_t>();
+            std::vector<double> params(model.numParams);
+            for (auto & param: params) {
+                param = reader.read<double>();
+            }
+            result[id] = makeColmapCamera(model, width, height, params);
+        }
+        return result;
+    }
+
+    TextReader reader(cameras.view());
+    std::string_view line;
+    while (reader.nextLine(line)) {
+        auto tokens = TextReader::tokens(line);
+        if (tokens.empty() || tokens[0][0] == '#') {
+            continue;
+        }
+        const ColmapModel * model = nullptr;
+        for (const auto & candidate: COLMAP_MODELS) {
+            if (tokens.size() > 1 && tokens[1] == candidate.name) {
+                model = &candidate;
+            }
+        }
+        if (model == nullptr || tokens.size() < 4 + model->numParams) {
+            throw std::runtime_error("Trajectory: unsupported COLMAP camera '" + std::string(line) + "'");
+        }
+        std::vector<double> params(model->numParams);
+        for (size_t p = 0; p < params.size(); p++) {
+            params[p] = parseNumber(tokens[4 + p]);
+        }
+        auto id = static_cast<uint32_t>(parseNumber(tokens[0]));
+        result[id] = makeColmapCamera(*model, static_cast<uint64_t>(parseNumber(tokens[2])),
+                                      static_cast<uint64_t>(parseNumber(tokens[3])), params);
+    }
+    return result;
+}
+
+} // namespace
+
+namespace Trajectory {
+
+std::vector<CameraPose> load(AAssetManager * assetManager, const std::string & path) {
+    std::vector<CameraPose> poses;
+    if (endsWith(path, ".npy")) {
+        poses = readLlff(*openMapped(assetManager, path));
+    } else if (endsWith(path, ".json")) {
+        poses = readTransformsJson(*openMapped(assetManager, path));
+    } else {
+        std::string directory = path.empty() || path.back() == '/' ? path : path + "/";
+        bool binary = exists(assetManager, directory + "images.bin");
+        const char * extension = binary ? ".bin" : ".txt";
+        poses = readColmap(*openMapped(assetManager, directory + "cameras" + extension),
+                           *openMapped(assetManager, directory + "images" + extension), binary);
+    }
+    LOGO("Trajectory %s: %zu poses", path.c_str(), poses.size());
+    return poses;
+}
+
+std::vector<CameraPose> readLlff(const MappedAsset & poses) {
+    constexpr size_t ROW = 17;
+    std::vector<size_t> shape;
+    size_t wordSize;
+    bool fortranOrder;
+    size_t dataOffset;
+    cnpy::parse_npy_header(poses.view(), wordSize, shape, fortranOrder, dataOffset);
+    if (shape.size() != 2 || shape[1] != ROW || fortranOrder || (wordSize != 8 && wordSize != 4)) {
+        throw std::runtime_error("Trajectory: " + poses.getName() + " is not an N x 17 LLFF pose array");
+    }
+    if (dataOffset + shape[0] * ROW * wordSize > poses.size()) {
+        throw std::runtime_error("Trajectory: " + poses.getName() + " is shorter than its header claims");
+    }
+
+    // the mapping is not necessarily aligned for doubles
+    const char * data = poses.data() + dataOffset;
+    auto value = [&](size_t index) {
+        if (wordSize == 4) {
+            float f;
+            std::memcpy(&f, data + index * 4, 4);
+            return static_cast<double>(f);
+        }
+        double d;
+        std::memcpy(&d, data + index * 8, 8);
+        return d;
+    };
+
+    std::vector<CameraPose> result(shape[0]);
+    for (size_t view = 0; view < shape[0]; view++) {
+        // 3x5 row-major: m(row, column)
+        auto m = [&](size_t row, size_t column) { return static_cast<float>(value(view * ROW + row * 5 + column)); };
+        glm::vec3 down(m(0, 0), m(1, 0), m(2, 0));
+        glm::vec3 right(m(0, 1), m(1, 1), m(2, 1));
+        glm::vec3 back(m(0, 2), m(1, 2), m(2, 2));
+        glm::vec3 position(m(0, 3), m(1, 3), m(2, 3));
+        result[view] = fromOpenGl(glm::mat3(right, -down, back), position);
+
+        double height = m(0, 4);
+        double width = m(1, 4);
+        double focal = m(2, 4);
+        setIntrinsics(result[view], focal, focal, width / 2.0, height / 2.0, static_cast<uint64_t>(width),
+                      static_cast<uint64_t>(height));
+    }
+    return result;
+}
+
+std::vector<CameraPose> readTransformsJson(const MappedAsset & transforms) {
+    JsonValue root = JsonParser(transforms.view()).parseDocument();
+    const JsonValue * frames = root.find("frames");
+    if (root.type != JsonValue::Type::OBJECT || frames == nullptr || frames->type != JsonValue::Type::ARRAY) {
+        throw std::runtime_error("Trajectory: " + transforms.getName() + " has no frames");
+    }
+
+    std::vector<CameraPose> result;
+    result.reserve(frames->items.size());
+    for (const auto & frame: frames->items) {
+        const JsonValue * matrix = frame.find("transform_matrix");
+        if (matrix == nullptr || matrix->items.size() < 3) {
+            throw std::runtime_error("Trajectory: frame without transform_matrix in " + transforms.getName());
+        }
+        // rows of the camera-to-world matrix; glm is column-major
+        glm::mat3 rotation;
+        glm::vec3 position;
+        for (int row = 0; row < 3; row++) {
+            const auto & items = matrix->items[row].items;
+            if (items.size() < 4) {
+                throw std::runtime_error("Trajectory: transform_matrix is not 4x4 in " + transforms.getName());
+            }
+            for (int column = 0; column < 3; column++) {
+                rotation[column][row] = static_cast<float>(items[column].number);
+            }
+            position[row] = static_cast<float>(items[3].number);
+        }
+        CameraPose pose = fromOpenGl(rotation, position);
+
+        // per-frame intrinsics override the shared ones
+        auto intrinsic = [&](std::string_view key) { return frame.numberOr(key, root.numberOr(key, 0.0)); };
+        double width = intrinsic("w");
+        double height = intrinsic("h");
+        double fx = intrinsic("fl_x");
+        double angleX = intrinsic("camera_angle_x");
+        if (fx <= 0.0 && angleX > 0.0 && width > 0.0) {
+            fx = 0.5 * width / std::tan(0.5 * angleX);
+        }
+        double fy = intrinsic("fl_y") > 0.0 ? intrinsic("fl_y") : fx;
+        setIntrinsics(pose, fx, fy, frame.numberOr("cx", root.numberOr("cx", width / 2.0)),
+                      frame.numberOr("cy", root.numberOr("cy", height / 2.0)), static_cast<uint64_t>(width),
+                      static_cast<uint64_t>(height));
+        if (pose.fovX == 0.0f && angleX > 0.0) {
+            // Blender exports give the angle without an image size
+            pose.fovX = static_cast<float>(angleX);
+        }
+        if (const JsonValue * path = frame.find("file_path")) {
+            pose.imageName = std::string(path->string);
+        }
+        result.push_back(std::move(pose));
+    }
+    return result;
+}
+
+std::vector<CameraPose> readColmap(const MappedAsset & cameras, const MappedAsset & images, bool binary) {
+    auto colmapCameras = readColmapCameras(cameras, binary);
+    std::vector<CameraPose> result;
+    auto addImage = [&](const glm::quat & rotation, const glm::vec3 & translation, uint32_t cameraId,
+                        std::string_view name) {
+        auto camera = colmapCameras.find(cameraId);
+        if (camera == colmapCameras.end()) {
+            throw std::runtime_error("Trajectory: image " + std::string(name) + " refers to a missing camera");
+        }
+        CameraPose pose = fromOpenCv(rotation, translation);
+        const ColmapCamera & c = camera->second;
+        setIntrinsics(pose, c.fx, c.fy, c.cx, c.cy, c.width, c.height);
+        pose.imageName = std::string(name);
+        result.push_back(std::move(pose));
+    };
+
+    if (binary) {
+        constexpr size_t POINT2D_BYTES = 2 * sizeof(double) + sizeof(int64_t);
+        BinaryReader reader(images.view(), images.getName());
+        auto count = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < count; i++) {
+            reader.read<uint32_t>();
+            double q[4];
+            double t[3];
+            for (double & v: q) {
+                v = reader.read<double>();
+            }
+            for (double & v: t) {
+                v = reader.read<double>();
+            }
+            auto cameraId = reader.read<uint32_t>();
+            std::string_view name = reader.readString();
+            reader.skip(reader.read<uint64_t>() * POINT2D_BYTES);
+            addImage(glm::quat(static_cast<float>(q[0]), static_cast<float>(q[1]), static_cast<float>(q[2]),
+                               static_cast<float>(q[3])),
+                     glm::vec3(static_cast<float>(t[0]), static_cast<float>(t[1]), static_cast<float>(t[2])),
+                     cameraId, name);
+        }
+    } else {
+        // two lines per image, the second (its 2D points) may be empty
+        TextReader reader(images.view());
+        std::string_view line;
+        bool pointsLine = false;
+        while (reader.nextLine(line)) {
+            if (!line.empty() && line[0] == '#') {
+                continue;
+            }
+            if (pointsLine) {
+                pointsLine = false;
+                continue;
+            }
+            auto tokens = TextReader::tokens(line);
+            if (tokens.empty()) {
+                continue;
+            }
+            if (tokens.size() < 10) {
+                throw std::runtime_error("Trajectory: malformed image line '" + std::string(line) + "'");
+            }
+            auto number = [&](size_t i) { return static_cast<float>(parseNumber(tokens[i])); };
+            addImage(glm::quat(number(1), number(2), number(3), number(4)),
+                     glm::vec3(number(5), number(6), number(7)), static_cast<uint32_t>(number(8)), tokens[9]);
+            pointsLine = true;
+        }
+    }
+
+    std::stable_sort(result.begin(), result.end(), [](const CameraPose & a, const CameraPose & b) {
+        return a.imageName < b.imageName;
+    });
+    return result;
+}
+
+} // namespace Trajectory
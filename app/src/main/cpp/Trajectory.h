@@ -0,0 +1,54 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <android/asset_manager.h>
+
+#include "MappedAsset.h"
+
+// One training view, converted to the renderer's camera convention: camera-to-world rotation with x right, y up
+// and the camera looking down -z (Renderer::Camera)
+struct CameraPose {
+    glm::vec3 position{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    // horizontal field of view in radians, 0 when the file has no intrinsics
+    float fovX = 0.0f;
+    // pinhole intrinsics in pixels of a width x height image, 0 when unknown
+    float fx = 0.0f;
+    float fy = 0.0f;
+    float cx = 0.0f;
+    float cy = 0.0f;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::string imageName;
+};
+
+// Camera trajectories of the training views, for profiling runs that replay them. Every reader parses the
+// mapped file in place.
+namespace Trajectory {
+    // Picks the reader from the path: *.npy (LLFF poses_bounds), *.json (NeRF transforms) or a COLMAP sparse
+    // model directory holding cameras and images as .bin or .txt. Paths starting with '/' are regular files,
+    // anything else an APK asset. Throws std::runtime_error for missing or malformed files.
+    std::vector<CameraPose> load(AAssetManager * assetManager, const std::string & path);
+
+    // N x 17 float64 rows: a 3x5 camera-to-world matrix [down, right, back, position, (height, width, focal)]
+    // followed by the near and far bounds
+    std::vector<CameraPose> readLlff(const MappedAsset & poses);
+
+    // camera_angle_x or fl_x/fl_y/cx/cy/w/h at the top level or per frame, frames[].transform_matrix is
+    // camera-to-world in OpenGL axes
+    std::vector<CameraPose> readTransformsJson(const MappedAsset & transforms);
+
+    // cameras.bin + images.bin or cameras.txt + images.txt; images are world-to-camera in OpenCV axes.
+    // The poses are sorted by image name, the order the training views are usually numbered in.
+    std::vector<CameraPose> readColmap(const MappedAsset & cameras, const MappedAsset & images, bool binary);
+}
+
+#endif //TRAJECTORY_H
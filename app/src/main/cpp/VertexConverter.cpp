@@ -0,0 +1,475 @@
+#include "VertexConverter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "WorkerPool.h"
+#include "base_utils.h"
+
+namespace {
+
+// tag type for IEEE half attributes, decoded on the CPU while converting
+struct Half {
+    uint16_t bits;
+};
+
+// the mapped PLY body has no alignment guarantees, all source reads go through memcpy
+inline float readFloat(const char *p) {
+    float v;
+    std::memcpy(&v, p, sizeof(float));
+    return v;
+}
+
+inline float readHalf(const char *p) {
+    uint16_t h;
+    std::memcpy(&h, p, sizeof(h));
+    return halfToFloat(h);
+}
+
+template<typename T>
+inline float readField(const char *p) {
+    if constexpr (std::is_same_v<T, Half>) {
+        return readHalf(p);
+    } else {
+        return readFloat(p);
+    }
+}
+
+// Minimal per-ISA float vector, just the operations the kernel needs
+#if defined(__ARM_NEON)
+struct Simd {
+    static constexpr int lanes = 4;
+    using f = float32x4_t;
+    static f load(const float *p) { return vld1q_f32(p); }
+    // one float from each of `lanes` consecutive records, `stride` bytes apart
+    static f gather(const char *p, size_t stride) {
+        float v[4] = {readFloat(p), readFloat(p + stride), readFloat(p + 2 * stride), readFloat(p + 3 * stride)};
+        return vld1q_f32(v);
+    }
+    static void store(float *p, f v) { vst1q_f32(p, v); }
+    static f set1(float v) { return vdupq_n_f32(v); }
+    static f add(f a, f b) { return vaddq_f32(a, b); }
+    static f sub(f a, f b) { return vsubq_f32(a, b); }
+    static f mul(f a, f b) { return vmulq_f32(a, b); }
+    static f div(f a, f b) { return vdivq_f32(a, b); }
+    static f min(f a, f b) { return vminq_f32(a, b); }
+    static f max(f a, f b) { return vmaxq_f32(a, b); }
+    static f sqrt(f a) { return vsqrtq_f32(a); }
+    static f floor(f a) { return vrndmq_f32(a); }
+    // 2^n for integral n
+    static f pow2(f n) {
+        int32x4_t e = vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127));
+        return vreinterpretq_f32_s32(vshlq_n_s32(e, 23));
+    }
+};
+#elif defined(__AVX2__)
+struct Simd {
+    static constexpr int lanes = 8;
+    using f = __m256;
+    static f load(const float *p) { return _mm256_loadu_ps(p); }
+    static f gather(const char *p, size_t stride) {
+        return _mm256_setr_ps(readFloat(p), readFloat(p + stride), readFloat(p + 2 * stride),
+                              readFloat(p + 3 * stride), readFloat(p + 4 * stride), readFloat(p + 5 * stride),
+                              readFloat(p + 6 * stride), readFloat(p + 7 * stride));
+    }
+    static void store(float *p, f v) { _mm256_storeu_ps(p, v); }
+    static f set1(float v) { return _mm256_set1_ps(v); }
+    static f add(f a, f b) { return _mm256_add_ps(a, b); }
+    static f sub(f a, f b) { return _mm256_sub_ps(a, b); }
+    static f mul(f a, f b) { return _mm256_mul_ps(a, b); }
+    static f div(f a, f b) { return _mm256_div_ps(a, b); }
+    static f min(f a, f b) { return _mm256_min_ps(a, b); }
+    static f max(f a, f b) { return _mm256_max_ps(a, b); }
+    static f sqrt(f a) { return _mm256_sqrt_ps(a); }
+    static f floor(f a) { return _mm256_floor_ps(a); }
+    static f pow2(f n) {
+        __m256i e = _mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+    }
+};
+#elif defined(__SSE2__)
+struct Simd {
+    static constexpr int lanes = 4;
+    using f = __m128;
+    static f load(const float *p) { return _mm_loadu_ps(p); }
+    static f gather(const char *p, size_t stride) {
+        return _mm_setr_ps(readFloat(p), readFloat(p + stride), readFloat(p + 2 * stride), readFloat(p + 3 * stride));
+    }
+    static void store(float *p, f v) { _mm_storeu_ps(p, v); }
+    static f set1(float v) { return _mm_set1_ps(v); }
+    static f add(f a, f b) { return _mm_add_ps(a, b); }
+    static f sub(f a, f b) { return _mm_sub_ps(a, b); }
+    static f mul(f a, f b) { return _mm_mul_ps(a, b); }
+    static f div(f a, f b) { return _mm_div_ps(a, b); }
+    static f min(f a, f b) { return _mm_min_ps(a, b); }
+    static f max(f a, f b) { return _mm_max_ps(a, b); }
+    static f sqrt(f a) { return _mm_sqrt_ps(a); }
+    static f floor(f a) {
+        // SSE2 has no floor: truncate, then step down where truncation rounded up
+        f t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+    }
+    static f pow2(f n) {
+        __m128i e = _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+    }
+};
+#else
+struct Simd {
+    static constexpr int lanes = 1;
+    using f = float;
+    static f load(const float *p) { return *p; }
+    static f gather(const char *p, size_t) { return readFloat(p); }
+    static void store(float *p, f v) { *p = v; }
+    static f set1(float v) { return v; }
+    static f add(f a, f b) { return a + b; }
+    static f sub(f a, f b) { return a - b; }
+    static f mul(f a, f b) { return a * b; }
+    static f div(f a, f b) { return a / b; }
+    static f min(f a, f b) { return std::min(a, b); }
+    static f max(f a, f b) { return std::max(a, b); }
+    static f sqrt(f a) { return std::sqrt(a); }
+    static f floor(f a) { return std::floor(a); }
+    static f pow2(f n) { return std::ldexp(1.0f, static_cast<int>(n)); }
+};
+#endif
+
+// Cephes-style exp, ~1 ulp on the range of log-scales and opacities found in splat files
+Simd::f expApprox(Simd::f x) {
+    using S = Simd;
+    x = S::min(S::max(x, S::set1(-87.3f)), S::set1(88.0f));
+    S::f fx = S::floor(S::add(S::mul(x, S::set1(1.44269504088896341f)), S::set1(0.5f)));
+    x = S::sub(x, S::mul(fx, S::set1(0.693359375f)));
+    x = S::sub(x, S::mul(fx, S::set1(-2.12194440e-4f)));
+
+    S::f z = S::mul(x, x);
+    S::f y = S::set1(1.9875691500e-4f);
+    y = S::add(S::mul(y, x), S::set1(1.3981999507e-3f));
+    y = S::add(S::mul(y, x), S::set1(8.3334519073e-3f));
+    y = S::add(S::mul(y, x), S::set1(4.1665795894e-2f));
+    y = S::add(S::mul(y, x), S::set1(1.6666665459e-1f));
+    y = S::add(S::mul(y, x), S::set1(5.0000001201e-1f));
+    y = S::add(S::add(S::mul(y, z), x), S::set1(1.0f));
+    return S::mul(y, S::pow2(fx));
+}
+
+// one attribute of `lanes` consecutive vertices
+template<typename T>
+inline Simd::f gatherField(const char *p, size_t stride) {
+    if constexpr (std::is_same_v<T, Half>) {
+        float v[Simd::lanes];
+        for (int l = 0; l < Simd::lanes; l++) {
+            v[l] = readHalf(p + l * stride);
+        }
+        return Simd::load(v);
+    } else {
+        return Simd::gather(p, stride);
+    }
+}
+
+// PLY stores SH channel-major (dc rgb, then all r, all g, all b of the higher bands),
+// the shader wants rgb interleaved per coefficient. Bands above the file's degree are zeroed.
+template<typename T, int SH_DEGREE>
+inline void transposeSh(const char *dc, const char *rest, float *out) {
+    constexpr int restPerChannel = (SH_DEGREE + 1) * (SH_DEGREE + 1) - 1;
+    out[0] = readField<T>(dc);
+    out[1] = readField<T>(dc + sizeof(T));
+    out[2] = readField<T>(dc + 2 * sizeof(T));
+    const char *r = rest;
+    const char *g = rest + restPerChannel * sizeof(T);
+    const char *b = rest + 2 * restPerChannel * sizeof(T);
+    int j = 0;
+#if defined(__ARM_NEON)
+    if constexpr (std::is_same_v<T, float>) {
+        for (; j + 4 <= restPerChannel; j += 4) {
+            float32x4x3_t rgb = {{vreinterpretq_f32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(r + j * sizeof(T)))),
+                                  vreinterpretq_f32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(g + j * sizeof(T)))),
+                                  vreinterpretq_f32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(b + j * sizeof(T))))}};
+            vst3q_f32(out + 3 + j * 3, rgb);
+        }
+    }
+#endif
+    for (; j < restPerChannel; j++) {
+        out[3 + j * 3 + 0] = readField<T>(r + j * sizeof(T));
+        out[3 + j * 3 + 1] = readField<T>(g + j * sizeof(T));
+        out[3 + j * 3 + 2] = readField<T>(b + j * sizeof(T));
+    }
+    std::fill(out + 3 + restPerChannel * 3, out + 48, 0.0f);
+}
+
+template<typename T, int SH_DEGREE>
+void convertScalarImpl(const char *src, const PlyVertexLayout &layout, SplatVertex *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const char *v = src + i * layout.stride;
+        SplatVertex &vertex = dst[i];
+        vertex.position = glm::vec4(readField<T>(v + layout.position[0]), readField<T>(v + layout.position[1]),
+                                    readField<T>(v + layout.position[2]), 1.0f);
+        glm::vec3 scale(readField<T>(v + layout.scale[0]), readField<T>(v + layout.scale[1]),
+                        readField<T>(v + layout.scale[2]));
+        float opacity = readField<T>(v + layout.opacity);
+        vertex.scale_opacity = glm::vec4(glm::exp(scale), 1.0f / (1.0f + std::exp(-opacity)));
+        vertex.rotation = glm::normalize(glm::vec4(readField<T>(v + layout.rotation[0]), readField<T>(v + layout.rotation[1]),
+                                                   readField<T>(v + layout.rotation[2]), readField<T>(v + layout.rotation[3])));
+        transposeSh<T, SH_DEGREE>(v + layout.shDc, v + layout.shRest, vertex.shs);
+    }
+}
+
+template<typename T, int SH_DEGREE>
+void convertKernel(const char *src, const PlyVertexLayout &layout, SplatVertex *dst, size_t count) {
+    using S = Simd;
+    constexpr int L = S::lanes;
+
+    // offsets are loop invariant, keep them out of the layout struct
+    const size_t stride = layout.stride;
+    const size_t px = layout.position[0], py = layout.position[1], pz = layout.position[2];
+    const size_t scaleX = layout.scale[0], scaleY = layout.scale[1], scaleZ = layout.scale[2];
+    const size_t opacityOffset = layout.opacity;
+    const size_t rw = layout.rotation[0], rx = layout.rotation[1], ry = layout.rotation[2], rz = layout.rotation[3];
+    const size_t shDc = layout.shDc, shRest = layout.shRest;
+
+    float sx[L], sy[L], sz[L], op[L], qw[L], qx[L], qy[L], qz[L];
+
+    size_t i = 0;
+    for (; i + L <= count; i += L) {
+        const char *block = src + i * stride;
+
+        // gather the transcendental inputs straight into vector registers
+        S::store(sx, expApprox(gatherField<T>(block + scaleX, stride)));
+        S::store(sy, expApprox(gatherField<T>(block + scaleY, stride)));
+        S::store(sz, expApprox(gatherField<T>(block + scaleZ, stride)));
+
+        S::f one = S::set1(1.0f);
+        S::f opacity = gatherField<T>(block + opacityOffset, stride);
+        S::store(op, S::div(one, S::add(one, expApprox(S::sub(S::set1(0.0f), opacity)))));
+
+        S::f w = gatherField<T>(block + rw, stride);
+        S::f x = gatherField<T>(block + rx, stride);
+        S::f y = gatherField<T>(block + ry, stride);
+        S::f z = gatherField<T>(block + rz, stride);
+        S::f norm2 = S::add(S::add(S::mul(w, w), S::mul(x, x)), S::add(S::mul(y, y), S::mul(z, z)));
+        S::f invNorm = S::div(one, S::sqrt(norm2));
+        S::store(qw, S::mul(w, invNorm));
+        S::store(qx, S::mul(x, invNorm));
+        S::store(qy, S::mul(y, invNorm));
+        S::store(qz, S::mul(z, invNorm));
+
+        // scatter, written front to back so write-combined staging memory sees sequential stores
+        for (int l = 0; l < L; l++) {
+            const char *v = block + l * stride;
+            SplatVertex &vertex = dst[i + l];
+            vertex.position = glm::vec4(readField<T>(v + px), readField<T>(v + py), readField<T>(v + pz), 1.0f);
+            vertex.scale_opacity = glm::vec4(sx[l], sy[l], sz[l], op[l]);
+            vertex.rotation = glm::vec4(qw[l], qx[l], qy[l], qz[l]);
+            transposeSh<T, SH_DEGREE>(v + shDc, v + shRest, vertex.shs);
+        }
+    }
+
+    convertScalarImpl<T, SH_DEGREE>(src + i * stride, layout, dst + i, count - i);
+}
+
+using ConvertFn = void (*)(const char *, const PlyVertexLayout &, SplatVertex *, size_t);
+
+template<typename T>
+ConvertFn selectForType(int shDegree, bool vectorized) {
+    switch (shDegree) {
+        case 0:
+            return vectorized ? convertKernel<T, 0> : convertScalarImpl<T, 0>;
+        case 1:
+            return vectorized ? convertKernel<T, 1> : convertScalarImpl<T, 1>;
+        case 2:
+            return vectorized ? convertKernel<T, 2> : convertScalarImpl<T, 2>;
+        default:
+            return vectorized ? convertKernel<T, 3> : convertScalarImpl<T, 3>;
+    }
+}
+
+// resolved once per call, never per vertex
+ConvertFn selectConverter(const PlyVertexLayout &layout, bool vectorized) {
+    if (layout.attributeType == PlyType::FLOAT16) {
+        return selectForType<Half>(layout.shDegree, vectorized);
+    }
+    return selectForType<float>(layout.shDegree, vectorized);
+}
+
+// Synthetic PLY in the layout most exporters write: float attributes, normals, SH degree 3
+std::string makeBenchmarkPly(size_t numVertices) {
+    std::ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\nelement vertex " << numVertices << "\n";
+    std::vector<std::string> names = {"x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2"};
+    for (int i = 0; i < 45; i++) {
+        names.push_back("f_rest_" + std::to_string(i));
+    }
+    for (const char *name: {"opacity", "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"}) {
+        names.emplace_back(name);
+    }
+    for (const auto &name: names) {
+        header << "property float " << name << "\n";
+    }
+    header << "end_header\n";
+
+    std::string ply = header.str();
+    size_t bodyOffset = ply.size();
+    size_t floatsPerVertex = names.size();
+    ply.resize(bodyOffset + numVertices * floatsPerVertex * sizeof(float));
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (size_t i = 0; i < numVertices * floatsPerVertex; i++) {
+        size_t property = i % floatsPerVertex;
+        float value = unit(gen);
+        if (names[property].rfind("scale_", 0) == 0) {
+            value = value * 5.0f - 3.0f;
+        } else if (names[property] == "opacity") {
+            value *= 6.0f;
+        } else if (property < 3) {
+            value *= 10.0f;
+        }
+        std::memcpy(&ply[bodyOffset + i * sizeof(float)], &value, sizeof(float));
+    }
+    return ply;
+}
+
+} // namespace
+
+float halfToFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1fu;
+    uint32_t mantissa = h & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0) {
+        // zero or subnormal: mantissa * 2^-24
+        float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    uint32_t magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u) {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u);
+    }
+    if (magnitude >= 0x477ff000u) {
+        // rounds to 65520 or more
+        return sign | 0x7c00u;
+    }
+    if (magnitude < 0x38800000u) {
+        // below the smallest normal half: the subnormal mantissa is value * 2^24
+        float absolute;
+        std::memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.0f));
+    }
+    uint32_t rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u);
+    return sign | static_cast<uint16_t>((rounded - 0x38000000u) >> 13);
+}
+
+void VertexConverter::convertScalar(const char *src, const PlyVertexLayout &layout, SplatVertex *dst, size_t count) {
+    selectConverter(layout, false)(src, layout, dst, count);
+}
+
+void VertexConverter::convert(const char *src, const PlyVertexLayout &layout, SplatVertex *dst, size_t count) {
+    selectConverter(layout, true)(src, layout, dst, count);
+}
+
+void VertexConverter::computeBounds(const char *src, const PlyVertexLayout &layout, size_t count,
+                                    glm::vec3 &boundsMin, glm::vec3 &boundsMax) {
+    std::mutex mutex;
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    bool half = layout.attributeType == PlyType::FLOAT16;
+    WorkerPool::shared().parallelFor(count, [&](size_t begin, size_t end) {
+        glm::vec3 rangeMin(std::numeric_limits<float>::max());
+        glm::vec3 rangeMax(std::numeric_limits<float>::lowest());
+        for (size_t i = begin; i < end; i++) {
+            const char *v = src + i * layout.stride;
+            glm::vec3 position;
+            for (int axis = 0; axis < 3; axis++) {
+                position[axis] = half ? readHalf(v + layout.position[axis]) : readFloat(v + layout.position[axis]);
+            }
+            rangeMin = glm::min(rangeMin, position);
+            rangeMax = glm::max(rangeMax, position);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        boundsMin = glm::min(boundsMin, rangeMin);
+        boundsMax = glm::max(boundsMax, rangeMax);
+    }, 16384);
+}
+
+void VertexConverter::runBenchmark(size_t numVertices) {
+    using clock = std::chrono::steady_clock;
+
+    std::string ply = makeBenchmarkPly(numVertices);
+    PlyHeader header = PlyHeader::parse(ply);
+    PlyVertexLayout layout = PlyVertexLayout::fromHeader(header);
+    const char *src = ply.data() + header.vertexOffset;
+
+    std::vector<SplatVertex> reference(numVertices);
+    std::vector<SplatVertex> output(numVertices);
+    std::memset(reference.data(), 0, reference.size() * sizeof(SplatVertex));
+
+    auto verticesPerSecond = [&](clock::time_point start) {
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        return numVertices / seconds;
+    };
+
+    // fault the output pages in first so the timings only cover the conversion
+    convertScalar(src, layout, output.data(), numVertices);
+
+    auto start = clock::now();
+    convertScalar(src, layout, reference.data(), numVertices);
+    double scalarRate = verticesPerSecond(start);
+    LOGO("Vertex conversion benchmark: %zu vertices (%s), %d SIMD lanes", numVertices, layout.describe().c_str(),
+         Simd::lanes);
+    LOGO("  scalar, 1 thread: %.2f Mvertices/s", scalarRate / 1e6);
+
+    auto &pool = WorkerPool::shared();
+    ConvertFn fn = selectConverter(layout, true);
+    double singleThreadRate = 0.0;
+    for (size_t threads = 1; threads <= pool.concurrency(); threads++) {
+        start = clock::now();
+        pool.parallelFor(numVertices, [&](size_t begin, size_t end) {
+            fn(src + begin * layout.stride, layout, output.data() + begin, end - begin);
+        }, 4096, threads);
+        double rate = verticesPerSecond(start);
+        if (threads == 1) {
+            singleThreadRate = rate;
+        }
+        LOGO("  simd, %zu thread(s): %.2f Mvertices/s (%.2fx scalar, %.2fx 1 thread)", threads, rate / 1e6,
+             rate / scalarRate, rate / singleThreadRate);
+    }
+
+    float maxError = 0.0f;
+    for (size_t i = 0; i < numVertices; i++) {
+        const float *a = reinterpret_cast<const float *>(&reference[i]);
+        const float *b = reinterpret_cast<const float *>(&output[i]);
+        for (size_t j = 0; j < sizeof(SplatVertex) / sizeof(float); j++) {
+            maxError = std::max(maxError, std::abs(a[j] - b[j]) / std::max(1.0f, std::abs(a[j])));
+        }
+    }
+    LOGO("  max relative error vs scalar: %g", maxError);
+}
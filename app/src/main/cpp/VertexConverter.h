@@ -0,0 +1,48 @@
+#ifndef VERTEXCONVERTER_H
+#define VERTEXCONVERTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "PlyHeader.h"
+
+// GPU layout of a splat, matches `Vertex` in shaders/common.glsl
+struct SplatVertex {
+    glm::vec4 position;
+    glm::vec4 scale_opacity;
+    glm::vec4 rotation;
+    float shs[48];
+};
+
+// SH coefficients (RGB triplets) up to and including `degree`
+constexpr uint32_t shCoefficientCount(uint32_t degree) {
+    return (degree + 1) * (degree + 1);
+}
+
+// IEEE 754 binary16 -> float, for half-precision PLY attributes
+float halfToFloat(uint16_t h);
+
+// float -> IEEE 754 binary16, round to nearest even, overflow to infinity
+uint16_t floatToHalf(float value);
+
+// Turns raw PLY vertices into SplatVertex: exp on scales, sigmoid on opacity,
+// quaternion normalization and the SH channel-major -> interleaved transpose.
+// Every entry point picks a converter specialized on the layout's attribute type and SH degree once per call;
+// src points at the first vertex record (PlyHeader::vertexOffset).
+namespace VertexConverter {
+    // Reference implementation, one vertex at a time
+    void convertScalar(const char * src, const PlyVertexLayout & layout, SplatVertex * dst, size_t count);
+
+    // Vectorized kernel (NEON on arm64, SSE/AVX on x86) working on several vertices per iteration.
+    // dst may be write-combined staging memory, the kernel only writes to it sequentially.
+    void convert(const char * src, const PlyVertexLayout & layout, SplatVertex * dst, size_t count);
+
+    // Axis-aligned bounds of the vertex positions, read from the source records on all cores
+    void computeBounds(const char * src, const PlyVertexLayout & layout, size_t count,
+                       glm::vec3 & boundsMin, glm::vec3 & boundsMax);
+
+    // Standalone CPU benchmark on synthetic vertices, logs vertices/s per thread count
+    void runBenchmark(size_t numVertices);
+}
+
+#endif //VERTEXCONVERTER_H
@@ -0,0 +1,103 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkerPool::WorkerPool(size_t numThreads) {
+    // the thread calling parallelFor also does work, so spawn one fewer
+    for (size_t i = 1; i < std::max<size_t>(numThreads, 1); i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+WorkerPool &WorkerPool::shared() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t, size_t)> &fn, size_t minRange,
+                             size_t maxThreads) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t threads = maxThreads == 0 ? concurrency() : std::min(maxThreads, concurrency());
+    size_t numRanges = std::min(threads, (count + minRange - 1) / std::max<size_t>(minRange, 1));
+    numRanges = std::max<size_t>(numRanges, 1);
+    if (numRanges == 1) {
+        fn(0, count);
+        return;
+    }
+
+    size_t rangeSize = (count + numRanges - 1) / numRanges;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    size_t remaining = numRanges - 1;
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t r = 1; r < numRanges; r++) {
+            size_t begin = r * rangeSize;
+            size_t end = std::min(count, begin + rangeSize);
+            tasks.emplace_back([&, begin, end] {
+                try {
+                    if (begin < end) {
+                        fn(begin, end);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> doneLock(doneMutex);
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> doneLock(doneMutex);
+                if (--remaining == 0) {
+                    doneCondition.notify_one();
+                }
+            });
+        }
+    }
+    taskAvailable.notify_all();
+
+    // first range runs on the calling thread
+    try {
+        fn(0, std::min(count, rangeSize));
+    } catch (...) {
+        std::lock_guard<std::mutex> doneLock(doneMutex);
+        error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> doneLock(doneMutex);
+    doneCondition.wait(doneLock, [&] { return remaining == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
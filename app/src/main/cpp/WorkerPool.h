@@ -0,0 +1,46 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU-side scene processing (PLY conversion etc.).
+// The threads are created once and reused for every load.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t numThreads);
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool();
+
+    // One worker per core, shared by everything that loads scenes
+    static WorkerPool & shared();
+
+    // Number of threads that take part in parallelFor (workers + the calling thread)
+    size_t concurrency() const { return workers.size() + 1; }
+
+    // Splits [0, count) into fixed contiguous ranges of at least minRange items, runs fn(begin, end)
+    // on each and blocks until all ranges are done. The calling thread works on a range as well.
+    // maxThreads limits how many threads are used (0 = all of them).
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> & fn,
+                     size_t minRange = 1024, size_t maxThreads = 0);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+};
+
+#endif //WORKERPOOL_H
@@ -10,7 +10,8 @@
 #include <iomanip>
 #include <stdint.h>
 #include <stdexcept>
-#include <regex>
+#include <fstream>
+#include <string>
 
 
 template<> std::vector<char>& cnpy::operator+=(std::vector<char>& lhs, const std::string rhs) {
@@ -28,86 +29,98 @@ template<> std::vector<char>& cnpy::operator+=(std::vector<char>& lhs, const cha
     return lhs;
 }
 
-// Helper function to read a line from AAsset (since fgets doesn't work on AAsset)
-std::string AAsset_getline(AAsset* asset) {
-    std::string line;
-    char c;
-    while (AAsset_read(asset, &c, 1) == 1) {
-        if (c == '\n') break;
-        line += c;
+namespace {
+
+size_t parseSize(std::string_view digits) {
+    size_t value = 0;
+    for (char c: digits) {
+        value = value * 10 + static_cast<size_t>(c - '0');
     }
-    return line;
+    return value;
 }
 
-void cnpy::parse_npy_header(AAsset* asset, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order) {
-    char buffer[11];
-    size_t res = AAsset_read(asset, buffer, 11);
-    if (res != 11)
-        throw std::runtime_error("parse_npy_header: failed AAsset_read");
+} // namespace
 
-    std::string header = AAsset_getline(asset);  // Read the header line
+void cnpy::parse_npy_header(std::string_view content, size_t& word_size, std::vector<size_t>& shape,
+                            bool& fortran_order, size_t& data_offset) {
+    // magic, version, then the header length: 2 bytes in version 1, 4 bytes in versions 2 and 3
+    if (content.size() < 10 || content.substr(0, 6) != "\x93NUMPY") {
+        throw std::runtime_error("parse_npy_header: not a .npy file");
+    }
+    auto byte = [&](size_t i) { return static_cast<size_t>(static_cast<uint8_t>(content[i])); };
+    size_t header_start = content[6] == 1 ? 10 : 12;
+    if (content.size() < header_start) {
+        throw std::runtime_error("parse_npy_header: truncated preamble");
+    }
+    size_t header_length = content[6] == 1 ? byte(8) | byte(9) << 8
+                                           : byte(8) | byte(9) << 8 | byte(10) << 16 | byte(11) << 24;
+    if (content.size() < header_start + header_length) {
+        throw std::runtime_error("parse_npy_header: truncated header");
+    }
+    std::string_view header = content.substr(header_start, header_length);
+    data_offset = header_start + header_length;
 
     size_t loc1, loc2;
 
     // Find "fortran_order"
     loc1 = header.find("fortran_order");
-    if (loc1 == std::string::npos)
+    if (loc1 == std::string_view::npos)
         throw std::runtime_error("parse_npy_header: failed to find header keyword: 'fortran_order'");
-    loc1 += 16;
-    fortran_order = (header.substr(loc1, 4) == "True");
+    loc1 = header.find(':', loc1);
+    loc2 = header.find_first_not_of(' ', loc1 + 1);
+    fortran_order = loc2 != std::string_view::npos && header.substr(loc2, 4) == "True";
 
     // Find shape
-    loc1 = header.find("(");
-    loc2 = header.find(")");
-    if (loc1 == std::string::npos || loc2 == std::string::npos)
+    loc1 = header.find('(');
+    loc2 = header.find(')');
+    if (loc1 == std::string_view::npos || loc2 == std::string_view::npos)
         throw std::runtime_error("parse_npy_header: failed to find header keyword: '(' or ')'");
 
-    std::regex num_regex("[0-9][0-9]*");
-    std::smatch sm;
     shape.clear();
-
-    std::string str_shape = header.substr(loc1 + 1, loc2 - loc1 - 1);
-    while (std::regex_search(str_shape, sm, num_regex)) {
-        shape.push_back(std::stoi(sm[0].str()));
-        str_shape = sm.suffix().str();
+    std::string_view str_shape = header.substr(loc1 + 1, loc2 - loc1 - 1);
+    size_t digits = str_shape.find_first_of("0123456789");
+    while (digits != std::string_view::npos) {
+        size_t digits_end = str_shape.find_first_not_of("0123456789", digits);
+        shape.push_back(parseSize(str_shape.substr(digits, digits_end - digits)));
+        digits = digits_end == std::string_view::npos ? digits_end : str_shape.find_first_of("0123456789", digits_end);
     }
 
-    // Parse "descr" field for word size
+    // Parse "descr" field for word size, e.g. '<f8'
     loc1 = header.find("descr");
-    if (loc1 == std::string::npos)
+    if (loc1 == std::string_view::npos)
         throw std::runtime_error("parse_npy_header: failed to find header keyword: 'descr'");
-    loc1 += 9;
-//    bool littleEndian = (header[loc1] == '<' || header[loc1] == '|');
+    loc1 = header.find('\'', header.find(':', loc1));
+    if (loc1 == std::string_view::npos || loc1 + 3 >= header.size())
+        throw std::runtime_error("parse_npy_header: malformed 'descr'");
+//    bool littleEndian = (header[loc1 + 1] == '<' || header[loc1 + 1] == '|');
 //    assert(littleEndian);
 
-    std::string str_ws = header.substr(loc1 + 2);
-    loc2 = str_ws.find("'");
-    word_size = std::stoi(str_ws.substr(0, loc2));
+    loc2 = header.find('\'', loc1 + 1);
+    word_size = parseSize(header.substr(loc1 + 3, loc2 - loc1 - 3));
 }
 
-cnpy::NpyArray load_the_npy_file(AAsset * asset) {
-    std::vector<size_t> shape;
-    size_t word_size;
-    bool fortran_order;
-
-    cnpy::parse_npy_header(asset, word_size, shape, fortran_order);
-
-    cnpy::NpyArray arr(shape, word_size, fortran_order);
-
-    // Read the actual data
-    size_t nread = AAsset_read(asset, arr.data<char>(), arr.num_bytes());
-    if(nread != arr.num_bytes())
-        throw std::runtime_error("load_the_npy_file: failed AAsset_read");
-    return arr;
+static size_t readStatusFieldKb(const char * field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t fieldLength = strlen(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, fieldLength, field) == 0) {
+            return std::strtoull(line.c_str() + fieldLength, nullptr, 10);
+        }
+    }
+    return 0;
 }
 
-cnpy::NpyArray cnpy::npy_load(AAssetManager *assetManager, const char * fname) {
-    AAsset *asset = AAssetManager_open(assetManager, fname, AASSET_MODE_BUFFER);
-
-    if(!asset) throw std::runtime_error("npy_load: Unable to open file " + std::string(fname));
+size_t readCurrentRssKb() {
+    return readStatusFieldKb("VmRSS:");
+}
 
-    cnpy::NpyArray arr = load_the_npy_file(asset);
+size_t readPeakRssKb() {
+    return readStatusFieldKb("VmHWM:");
+}
 
-    AAsset_close(asset);
-    return arr;
-}
\ No newline at end of file
+void resetPeakRss() {
+    // "5" resets the peak resident set size (Linux >= 4.0); ignored if not permitted
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
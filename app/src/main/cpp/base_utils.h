@@ -2,6 +2,7 @@
 #define GAUSSIAN_SPLATTING_UTILS_H
 
 #include <android/log.h>
+#include <string_view>
 #include <vector>
 #include <android/asset_manager_jni.h>
 
@@ -21,51 +22,61 @@ enum ProfilingMode {
     FPS,
     PSNR,
     MEM,
+    LOAD,
+    // renders every scene in file order and in Morton order and logs the GPU times of both
+    ORDER,
+    // renders the scene unpruned and pruned from every pose of the profiling trajectory and logs the PSNR between them
+    PRUNE,
+    // renders every scene with square and with opacity-aware splat extents and logs the instances and GPU times of both
+    EXTENTS,
 };
 
-namespace cnpy {
-
-    struct NpyArray {
-        NpyArray(const std::vector<size_t>& _shape, size_t _word_size, bool _fortran_order) :
-                shape(_shape), word_size(_word_size), fortran_order(_fortran_order)
-        {
-            num_vals = 1;
-            for(size_t i = 0;i < shape.size();i++) num_vals *= shape[i];
-            data_holder = std::shared_ptr<std::vector<char>>(
-                    new std::vector<char>(num_vals * word_size));
-        }
-
-        NpyArray() : shape(0), word_size(0), fortran_order(0), num_vals(0) { }
-
-        template<typename T>
-        T* data() {
-            return reinterpret_cast<T*>(&(*data_holder)[0]);
-        }
+// How splats stay resident on the GPU, see shaders/splat_storage.glsl
+enum class SplatStorage {
+    // separate position + opacity, SH and padded cov3D streams, 16 + 192 + 32 bytes per splat
+    FLOAT32,
+    // CompressedSplat (64 bytes), fp32 cov3D (24) and per-chunk ranges (under 1), about 88 bytes resident per splat.
+    // The cov3D keeps this above the 64 byte target.
+    COMPRESSED,
+    // CodebookSplat (64 bytes) with a 16-bit index into one k-means codebook for SH bands 1-3, fp32 cov3D (24)
+    SH_CODEBOOK,
+    // HalfSplat and fp16 cov3D, 128 + 12 bytes per splat; needs storageBuffer16BitAccess
+    HALF,
+};
 
-        template<typename T>
-        const T* data() const {
-            return reinterpret_cast<T*>(&(*data_holder)[0]);
-        }
+// Order the splats are uploaded in. The scene cache keeps one file per order.
+enum class SplatOrder {
+    // as stored in the scene file
+    FILE_ORDER,
+    // along a Morton curve over the scene bounds, so neighboring invocations read nearby splats
+    MORTON,
+    // most important first, used by progressive loads
+    IMPORTANCE,
+};
 
-        template<typename T>
-        std::vector<T> as_vec() const {
-            const T* p = data<T>();
-            return std::vector<T>(p, p+num_vals);
-        }
+// Load-time pruning thresholds, see SplatPruning. A zero disables its test.
+struct PruneOptions {
+    // sigmoid opacity; below 0.5 / 255 a splat never passes the alpha test of render.comp
+    float minOpacity = 0.0f;
+    // world-space volume of the 1 sigma ellipsoid
+    float minVolume = 0.0f;
+    // floaters are splats whose distance to their floaterNeighbors-th nearest neighbor exceeds this multiple of
+    // the scene median
+    float floaterDistanceFactor = 0.0f;
+    uint32_t floaterNeighbors = 8;
+};
 
-        size_t num_bytes() const {
-            return data_holder->size();
-        }
+// Process memory counters from /proc/self/status, in kilobytes
+size_t readCurrentRssKb();
+size_t readPeakRssKb();
+// Resets the VmHWM high-water mark so a later readPeakRssKb() covers only what follows
+void resetPeakRss();
 
-        std::shared_ptr<std::vector<char>> data_holder;
-        std::vector<size_t> shape;
-        size_t word_size;
-        bool fortran_order;
-        size_t num_vals;
-    };
+namespace cnpy {
 
-    void parse_npy_header(AAsset* asset, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order);
-    NpyArray npy_load(AAssetManager *assetManager, const char * fname);
+    // Parses the header of a .npy file held in memory; the array data starts at data_offset
+    void parse_npy_header(std::string_view content, size_t& word_size, std::vector<size_t>& shape,
+                          bool& fortran_order, size_t& data_offset);
 
     template<typename T> std::vector<char>& operator+=(std::vector<char>& lhs, const T rhs) {
         //write in little endian
@@ -78,14 +89,6 @@ namespace cnpy {
 
     template<> std::vector<char>& operator+=(std::vector<char>& lhs, const std::string rhs);
     template<> std::vector<char>& operator+=(std::vector<char>& lhs, const char* rhs);
-
-    void
-    parse_npy_header(AAsset *asset, size_t &word_size, std::vector<size_t> &shape,
-                     bool &fortran_order);
-
-    void
-    parse_npy_header(AAsset *asset, size_t &word_size, std::vector<size_t> &shape,
-                     bool &fortran_order);
 }
 
 #endif //GAUSSIAN_SPLATTING_UTILS_H
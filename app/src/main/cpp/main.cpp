@@ -15,6 +15,7 @@
 #include <game-activity/native_app_glue/android_native_app_glue.h>
 
 #include "base_utils.h"
+#include "VertexConverter.h"
 
 static std::unique_ptr<VulkanSplatting> vulkanSplatting = nullptr;
 /*
@@ -126,62 +127,32 @@ extern "C" bool VulkanMotionEventFilter(const GameActivityMotionEvent *event) {
     return true; // Event was handled
 }
 
-void file_to_string(const char * file_name, AAssetManager *assetManager, std::string & output){
-    AAsset *asset = AAssetManager_open(assetManager, file_name, AASSET_MODE_BUFFER);
-    // check that the scene file exists
-    if (asset == nullptr) {
-        LOGO("File does not exist: %s", file_name);
-        return;
-    }
-
-    // read file into a string and pass it to be parsed via VulkanSplatting.configuration
-    size_t size = AAsset_getLength(asset);
-    const void *buffer = AAsset_getBuffer(asset);
-    std::string ret(static_cast<const char*>(buffer), size);
-    output = ret;
-
-    AAsset_close(asset);
-}
-
-void processForProfiler(
-        AAssetManager * assetManager,
-        const char * posePath,
-        ProfilingMode profilingMode,
-        std::vector<glm::mat3x3> & rotations,
-        std::vector<glm::vec3> & translations)
-{
-    if(profilingMode == PSNR) {
-        cnpy::NpyArray arr = cnpy::npy_load(assetManager, posePath);
-        std::vector<double> vec = arr.as_vec<double>();
-
-//        int elems_to_read = vec.size();
-        int elems_to_read = 1;
-
-        for (int view_i = 0; view_i < elems_to_read * arr.shape[1]; view_i += arr.shape[1]) {
-            glm::mat3x3 cur_rot;
-            for (int j = 0; j < 3; j++) {
-                for (int k = 0; k < 3; k++) {
-                    int index = view_i + j * 5;
-                    cur_rot[j][k] = float(vec[index + k]);
-                }
-            }
-            rotations.push_back(cur_rot);
-
-            glm::vec3 cur_trans = glm::vec3{
-                    static_cast<float>(vec[view_i + 3]),
-                    static_cast<float>(vec[view_i + 8]),
-                    static_cast<float>(vec[view_i + 13]),
-            };
-            translations.push_back(cur_trans);
-        }
-    }
-}
-
 int main_cpp(const char *pose_path, android_app *state) {
 
     ProfilingMode profilingMode;
     bool useValidationLayers;
     bool noGuiFlag;
+    // resident splat layout, COMPRESSED trades some color precision for ~4x less VRAM and bandwidth
+    SplatStorage splatStorage = SplatStorage::FLOAT32;
+    // SH bands above this are dropped at load time
+    uint32_t maxShDegree = 3;
+    // first frame after ~10% of the scene, the rest streams in importance order
+    bool progressiveLoad = false;
+    // scenes over this many bytes of splats stream their chunks near the camera, 0 keeps them fully resident
+    size_t residencyBudget = 0;
+    // upload order of the splats, ProfilingMode ORDER compares FILE_ORDER against MORTON
+    SplatOrder splatOrder = SplatOrder::MORTON;
+    // load-time pruning; ProfilingMode PRUNE reports what it removed and the PSNR it costs
+    PruneOptions pruning{0.5f / 255.0f};
+    // scenes switched away from stay on the GPU up to this many bytes, revisiting them only rebinds buffers
+    size_t gpuSceneBudget = 512 * 1024 * 1024;
+    // FLOAT32 PLY scenes upload the raw vertex records and convert them in a compute shader
+    bool gpuDecode = true;
+    // opacity-aware per-axis tile extents; ProfilingMode EXTENTS compares them against the square ones
+    bool tightExtents = true;
+    // SH colors are reused while the view direction to a splat turns less than this many degrees
+    float colorCacheTolerance = 1.0f;
+    uint32_t colorCacheRefreshPeriod = 16;
 #ifdef DEBUG
     profilingMode = NONE;
     noGuiFlag = false;
@@ -206,77 +177,85 @@ int main_cpp(const char *pose_path, android_app *state) {
 
     AAssetManager *assetManager = state->activity->assetManager;
 
+    if(profilingMode == LOAD) {
+        // CPU-only measurement of the PLY -> GPU layout conversion, independent of the scene assets
+        VertexConverter::runBenchmark(1 << 20);
+    }
+
     int scene_path_index = 0;
     std::vector<std::string> scene_paths = {"point_cloud.ply", "export.ply", "afshin_27k.ply"};
-    int num_scenes = scene_paths.size();
-
-    while(true){
-        android_app_set_motion_event_filter(state, NULL);
-        vulkanSplatting.reset();
 
-        LOGD("Loading .ply file %s", scene_paths[scene_path_index].c_str());
-        std::string assetContent;
-        const char * scene_path = scene_paths[scene_path_index].c_str();
-        file_to_string(scene_path, assetManager, assetContent);
+    LOGD("Loading scene %s", scene_paths[scene_path_index].c_str());
+    const char * scene_path = scene_paths[scene_path_index].c_str();
+    auto sceneAsset = MappedAsset::fromAsset(assetManager, scene_path);
 
-        std::vector<glm::mat3x3> rotations;
-        std::vector<glm::vec3> translations;
-        if(profilingMode == PSNR) {
-            processForProfiler(assetManager, pose_path, profilingMode, rotations, translations);
-        }
-
-        LOGD("Configuring Renderer...");
-        VulkanSplatting::RendererConfiguration config{
-                useValidationLayers,
-                envVars.get(physicalDeviceId).has_value()
-                ? std::make_optional(envVars.get(physicalDeviceId).value())
-                : std::nullopt,
-                envVars.get_or(immediateSwapchain, false),
-                assetContent,
-                .profilingMode = profilingMode,
-                .rotations = rotations,
-                .translations = translations,
-                .assetManager = assetManager,
-        };
-
-        int validationLayersFlag = 0;
-        int physicalDeviceIdFlag = 0;
-        int immediateSwapchainFlag = 0;
-
-        if (validationLayersFlag) {
-            config.enableVulkanValidationLayers = validationLayersFlag;
-        }
+    // every training view, in the order of the pose file
+    std::vector<CameraPose> trajectory;
+    if(profilingMode == PSNR || profilingMode == PRUNE) {
+        trajectory = Trajectory::load(assetManager, pose_path);
+    }
 
-        if (physicalDeviceIdFlag) {
-            config.physicalDeviceId = std::make_optional<uint8_t>(static_cast<uint8_t>(0));
-        }
+    LOGD("Configuring Renderer...");
+    VulkanSplatting::RendererConfiguration config{
+            useValidationLayers,
+            envVars.get(physicalDeviceId).has_value()
+            ? std::make_optional(envVars.get(physicalDeviceId).value())
+            : std::nullopt,
+            envVars.get_or(immediateSwapchain, false),
+            std::move(sceneAsset),
+            .profilingMode = profilingMode,
+            .trajectory = trajectory,
+            .assetManager = assetManager,
+            .cacheDir = state->activity->internalDataPath ? state->activity->internalDataPath : "",
+            .splatStorage = splatStorage,
+            .maxShDegree = maxShDegree,
+            .progressiveLoad = progressiveLoad,
+            .residencyBudget = residencyBudget,
+            .splatOrder = splatOrder,
+            .pruning = pruning,
+            .gpuSceneBudget = gpuSceneBudget,
+            .gpuDecode = gpuDecode,
+            .tightExtents = tightExtents,
+            .colorCacheTolerance = colorCacheTolerance,
+            .colorCacheRefreshPeriod = colorCacheRefreshPeriod,
+            .scenePaths = scene_paths,
+    };
+
+    int validationLayersFlag = 0;
+    int physicalDeviceIdFlag = 0;
+    int immediateSwapchainFlag = 0;
+
+    if (validationLayersFlag) {
+        config.enableVulkanValidationLayers = validationLayersFlag;
+    }
 
-        if (immediateSwapchainFlag) {
-            config.immediateSwapchain = immediateSwapchainFlag;
-        }
+    if (physicalDeviceIdFlag) {
+        config.physicalDeviceId = std::make_optional<uint8_t>(static_cast<uint8_t>(0));
+    }
 
-        if (noGuiFlag) {
-            config.enableGui = false;
-        } else {
-            config.enableGui = true;
-        }
+    if (immediateSwapchainFlag) {
+        config.immediateSwapchain = immediateSwapchainFlag;
+    }
 
-        int width = 0;
-        int height = 0;
-        config.window = VulkanSplatting::createAndroidWindow(state->window, width, height);
+    if (noGuiFlag) {
+        config.enableGui = false;
+    } else {
+        config.enableGui = true;
+    }
 
-        // auto renderer = VulkanSplatting(config);
-        vulkanSplatting = std::make_unique<VulkanSplatting>(config);
-        vulkanSplatting->initialize(scene_path_index);
-        scene_path_index = (scene_path_index + 1) % num_scenes;
+    int width = 0;
+    int height = 0;
+    config.window = VulkanSplatting::createAndroidWindow(state->window, width, height);
 
-        // read touch inputs
-        state->motionEventFilter = VulkanMotionEventFilter;
-        android_app_set_motion_event_filter(state, VulkanMotionEventFilter);
+    // the renderer lives for the whole session, scene switches load the next scene in the background
+    vulkanSplatting = std::make_unique<VulkanSplatting>(config);
+    vulkanSplatting->initialize(scene_path_index);
 
-        vulkanSplatting->run();
+    // read touch inputs
+    state->motionEventFilter = VulkanMotionEventFilter;
+    android_app_set_motion_event_filter(state, VulkanMotionEventFilter);
 
-    }
+    vulkanSplatting->run();
 
     return 0;
 }
@@ -321,6 +300,7 @@ void android_main(struct android_app *state) {
         }
     }
 
+    // poses_bounds.npy, transforms.json or a COLMAP sparse model directory (cameras/images .bin or .txt)
     const char * poses_path = "poses_bounds.npy";
 
     main_cpp(poses_path, state);
@@ -11,7 +11,8 @@
 #define assert( condition, message, value )
 #endif
 
-#define MAGIC 0x4d415449u
+// render.comp skips a splat on a pixel where its alpha falls below this
+#define ALPHA_THRESHOLD (0.5 / 255.0)
 
 const float SH_C0 = 0.28209479177387814f;
 const float SH_C1 = 0.4886025119029199f;
@@ -39,15 +40,68 @@ struct Vertex {
     float sh[48];
 };
 
+// Renderer::VisibleSplats. groups is the indirect dispatch over the visible splats, sort_groups and instance_groups
+// those of the radix sort and tile_boundary over the instances that fit the sort buffers.
+struct VisibleSplats {
+    uint groups_x;
+    uint groups_y;
+    uint groups_z;
+    uint count;
+    // scan total, read back to grow the sort buffers
+    uint instances;
+    uint sorted_instances;
+    uint sort_groups_x;
+    uint sort_groups_y;
+    uint sort_groups_z;
+    uint instance_groups_x;
+    uint instance_groups_y;
+    uint instance_groups_z;
+    // splats whose color preprocess evaluated from SH instead of the color cache
+    uint sh_evaluations;
+};
+
 struct VertexAttribute {
     vec4 conic_opacity;
     vec4 color_radii;
     uvec4 aabb;
     vec2 uv;
     float depth;
-    uint magic;
+    // squared Mahalanobis distance past which alpha stays below ALPHA_THRESHOLD, 0 keeps every tile of aabb
+    float cutoff_sq;
 };
 
+// Smallest d^T conic d over the pixels of a tile, d from the splat center. 0 when the center is inside the tile,
+// otherwise the minimum lies on an edge: along each edge the form is a 1D quadratic minimized at its clamped vertex.
+// precise keeps the result bit-identical between the shaders that count and that emit the tiles.
+float tile_min_distance_sq(vec2 center, vec3 conic, uvec2 tile) {
+    vec2 lo = vec2(tile * uvec2(TILE_WIDTH, TILE_HEIGHT)) - center;
+    vec2 hi = lo + vec2(TILE_WIDTH - 1, TILE_HEIGHT - 1);
+    if (all(lessThanEqual(lo, vec2(0.0))) && all(greaterThanEqual(hi, vec2(0.0)))) {
+        return 0.0;
+    }
+
+    // conic = (a, b, c) for a x^2 + 2 b x y + c y^2, the power render.comp evaluates
+    precise float best = 3.402823e38;
+    for (int edge = 0; edge < 2; edge++) {
+        float x = edge == 0 ? lo.x : hi.x;
+        precise float y = clamp(-conic.y * x / conic.z, lo.y, hi.y);
+        precise float q = conic.x * x * x + 2.0 * conic.y * x * y + conic.z * y * y;
+        best = min(best, q);
+    }
+    for (int edge = 0; edge < 2; edge++) {
+        float y = edge == 0 ? lo.y : hi.y;
+        precise float x = clamp(-conic.y * y / conic.x, lo.x, hi.x);
+        precise float q = conic.x * x * x + 2.0 * conic.y * x * y + conic.z * y * y;
+        best = min(best, q);
+    }
+    return best;
+}
+
+// preprocess counts and preprocess_sort emits keys for the same tiles of a splat's aabb
+bool splat_touches_tile(VertexAttribute a, uvec2 tile) {
+    return a.cutoff_sq <= 0.0 || tile_min_distance_sq(a.uv, a.conic_opacity.xyz, tile) <= a.cutoff_sq;
+}
+
 mat3 rotationFromQuaternion(vec4 q) {
     float qx = q.y;
     float qy = q.z;
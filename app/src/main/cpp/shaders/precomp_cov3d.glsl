@@ -0,0 +1,64 @@
+// Body of precomp_cov3d.comp and its storage variants, see splat_storage.glsl
+#include "./common.glsl"
+
+#define SPLAT_STORAGE_SET 0
+#define SPLAT_VERTEX_BINDING 0
+#define SPLAT_STORAGE_DATA_BINDING 2
+#define SPLAT_GEOMETRY_BINDING 3
+#include "./splat_storage.glsl"
+
+layout (std430, binding = 1) writeonly buffer Cov3Ds {
+    SPLAT_COV3D_SCALAR cov3ds[];
+};
+
+layout( push_constant ) uniform Constants
+{
+    float scale_factor;
+    // the load computes cov3D batch by batch
+    uint first_splat;
+    uint splat_range;
+};
+
+layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+void main() {
+    uint index = first_splat + gl_GlobalInvocationID.x;
+    if (gl_GlobalInvocationID.x >= splat_range || index >= splat_count()) {
+        return;
+    }
+
+#ifdef SPLAT_STREAMS
+    // the geometry buffer holds the current batch only; position and opacity stay resident, scale and rotation not
+    SplatGeometry splat = geometry[gl_GlobalInvocationID.x];
+    positions[index] = splat.position_opacity;
+    vec3 scale = splat.scale.xyz;
+    vec4 rotation = splat.rotation;
+#else
+    vec3 scale = splat_scale(index);
+    vec4 rotation = splat_rotation(index);
+#endif
+    mat3 S = mat3(1.0);
+    S[0][0] = scale.x * scale_factor;
+    S[1][1] = scale.y * scale_factor;
+    S[2][2] = scale.z * scale_factor;
+
+    // Compute rotation matrix from quaternion
+    mat3 R = rotationFromQuaternion(rotation);
+
+    mat3 M = S * R;
+    mat3 cov3d = transpose(M) * M;
+
+    cov3ds[index * SPLAT_COV3D_STRIDE] = SPLAT_COV3D_SCALAR(cov3d[0][0]);
+    cov3ds[index * SPLAT_COV3D_STRIDE + 1] = SPLAT_COV3D_SCALAR(cov3d[0][1]);
+    cov3ds[index * SPLAT_COV3D_STRIDE + 2] = SPLAT_COV3D_SCALAR(cov3d[0][2]);
+    cov3ds[index * SPLAT_COV3D_STRIDE + 3] = SPLAT_COV3D_SCALAR(cov3d[1][1]);
+    cov3ds[index * SPLAT_COV3D_STRIDE + 4] = SPLAT_COV3D_SCALAR(cov3d[1][2]);
+    cov3ds[index * SPLAT_COV3D_STRIDE + 5] = SPLAT_COV3D_SCALAR(cov3d[2][2]);
+
+    #ifdef DEBUG
+    if (index == 0) {
+        debugPrintfEXT("scale: %f %f %f\n", scale.x, scale.y, scale.z);
+        debugPrintfEXT("cov3d: %f %f %f %f %f %f\n", cov3d[0][0], cov3d[0][1], cov3d[0][2], cov3d[1][1], cov3d[1][2], cov3d[2][2]);
+    }
+    #endif
+}
\ No newline at end of file
@@ -0,0 +1,328 @@
+// Body of preprocess.comp and its storage variants, see splat_storage.glsl
+#extension GL_KHR_shader_subgroup_ballot : enable
+#include "./common.glsl"
+
+#define SPLAT_STORAGE_SET 0
+#define SPLAT_VERTEX_BINDING 0
+#define SPLAT_STORAGE_DATA_BINDING 2
+#include "./splat_storage.glsl"
+
+// 1: the tile rectangle covers where the splat's alpha passes ALPHA_THRESHOLD, per axis.
+// 0: a square of 3 sigma along the largest eigenvalue of the 2D covariance, whatever the opacity.
+layout (constant_id = 1) const uint TIGHT_EXTENTS = 1u;
+
+layout (std430, set = 0, binding = 1) readonly buffer Cov3Ds {
+    SPLAT_COV3D_SCALAR cov3ds[];
+};
+
+layout (std140, set = 1, binding = 0) uniform Params {
+    vec4 camera_position;
+    mat4 proj_mat;
+    mat4 view_mat;
+    uint width;
+    uint height;
+    float tan_fovx;
+    float tan_fovy;
+    // splats at and past this index are still streaming in
+    uint resident_splats;
+    // slot size of an out-of-core scene (GSScene::RESIDENCY_CHUNK_SPLATS), 0 when the whole scene is resident
+    uint chunk_splats;
+    // cosine of the angle a view direction may drift from the cached one, above 1 when the color cache is off
+    float color_cache_cos;
+    // a splat drawn on the frame where index % period == frame_index % period re-evaluates its SH, 0 for only on drift
+    uint color_refresh_period;
+    uint frame_index;
+};
+
+// visible splats only, packed in the order they were appended
+layout (std430, set = 1, binding = 1) writeonly buffer VertexAttributes {
+    VertexAttribute attr[];
+};
+
+layout (std430, set = 1, binding = 2) writeonly buffer NumTilesOverlap {
+    uint tiles_overlap[];
+};
+
+// splats drawn per slot, the rest of a slot is empty or still streaming in
+layout (std430, set = 1, binding = 3) readonly buffer SlotSplats {
+    uint slot_splats[];
+};
+
+// reset to zero visible splats before the dispatch
+layout (std430, set = 1, binding = 4) buffer Visible {
+    VisibleSplats visible;
+};
+
+// last SH color of each splat and the octahedral view direction it was evaluated for
+struct ColorCacheEntry {
+    vec3 color;
+    uint direction;
+};
+
+// packSnorm2x16 never produces -32768, Renderer::clearColorCache fills the cache with it
+#define COLOR_CACHE_EMPTY 0x80008000u
+
+layout (std430, set = 1, binding = 5) buffer ColorCache {
+    ColorCacheEntry color_cache[];
+};
+
+layout (local_size_x = TILE_WIDTH * TILE_HEIGHT, local_size_y = 1, local_size_z = 1) in;
+
+// set by cached_color when it had to evaluate the SH, counted per subgroup in main
+bool sh_evaluated = false;
+
+mat3 get_projection_jacobian_approx(vec3 t) {
+    float limx = 1.3 * tan_fovx;
+    float limy = 1.3 * tan_fovy;
+    float txtz = t.x / t.z;
+    float tytz = t.y / t.z;
+    t.x = min(limx, max(-limx, txtz)) * t.z;
+    t.y = min(limy, max(-limy, tytz)) * t.z;
+
+    float focal_x = width / (2 * tan_fovx);
+    float focal_y = height / (2 * tan_fovy);
+
+    return mat3(
+        focal_x / t.z, 0, -(focal_x * t.x) / (t.z * t.z),
+        0, focal_y / t.z, -(focal_y * t.y) / (t.z * t.z),
+        0, 0, 0
+    );
+}
+
+mat2 compute_cov2d(vec3 cam) {
+    uint index = gl_GlobalInvocationID.x;
+    mat3 J = get_projection_jacobian_approx(cam);
+    mat3 W = transpose(mat3(view_mat));
+    float c[6];
+    for (int i = 0; i < 6; i++) {
+        c[i] = float(cov3ds[index * SPLAT_COV3D_STRIDE + i]);
+    }
+    mat3 Sigma = mat3(
+        c[0], c[1], c[2],
+        c[1], c[3], c[4],
+        c[2], c[4], c[5]
+    );
+    mat3 T = W * J;
+    mat3 cov2d = transpose(T) * Sigma * T;
+    cov2d[0][0] += 0.25f;
+    cov2d[1][1] += 0.25f;
+    return mat2(cov2d);
+}
+
+vec3 get_sh_vec3(uint ind) {
+    return splat_sh(gl_GlobalInvocationID.x, ind);
+}
+
+vec3 compute_sh() {
+    uint index = gl_GlobalInvocationID.x;
+
+    vec3 ray_direction = splat_position(index) - camera_position.xyz;
+    ray_direction /= length(ray_direction);
+    float x = ray_direction.x, y = ray_direction.y, z = ray_direction.z;
+
+    vec3 c = SH_C0 * get_sh_vec3(0);
+
+    // SPLAT_SH_DEGREE is a specialization constant, the untaken branches are removed when the pipeline is built
+    if (SPLAT_SH_DEGREE >= 1) {
+        c -= SH_C1 * get_sh_vec3(1) * y;
+        c += SH_C1 * get_sh_vec3(2) * z;
+        c -= SH_C1 * get_sh_vec3(3) * x;
+    }
+
+    if (SPLAT_SH_DEGREE >= 2) {
+        c += SH_C2[0] * get_sh_vec3(4) * x * y;
+        c += SH_C2[1] * get_sh_vec3(5) * y * z;
+        c += SH_C2[2] * get_sh_vec3(6) * (2.0 * z * z - x * x - y * y);
+        c += SH_C2[3] * get_sh_vec3(7) * z * x;
+        c += SH_C2[4] * get_sh_vec3(8) * (x * x - y * y);
+    }
+
+    if (SPLAT_SH_DEGREE >= 3) {
+        c += SH_C3[0] * get_sh_vec3(9) * (3.0 * x * x - y * y) * y;
+        c += SH_C3[1] * get_sh_vec3(10) * x * y * z;
+        c += SH_C3[2] * get_sh_vec3(11) * (4.0 * z * z - x * x - y * y) * y;
+        c += SH_C3[3] * get_sh_vec3(12) * z * (2.0 * z * z - 3.0 * x * x - 3.0 * y * y);
+        c += SH_C3[4] * get_sh_vec3(13) * x * (4.0 * z * z - x * x - y * y);
+        c += SH_C3[5] * get_sh_vec3(14) * (x * x - y * y) * z;
+        c += SH_C3[6] * get_sh_vec3(15) * x * (x * x - 3.0 * y * y);
+    }
+
+    c += 0.5;
+
+    if (c.x < 0.0) {
+        c.x = 0.0;
+    }
+
+//    assert(all(lessThanEqual(c, vec3(159.0))), "invalid sh: %f %f %f\n", c);
+    return c;
+}
+
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octahedral_encode(vec3 n) {
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? p : (1.0 - abs(p.yx)) * sign_not_zero(p);
+}
+
+vec3 octahedral_decode(vec2 p) {
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    }
+    return normalize(n);
+}
+
+// SH color for the current view, reused from the cache while the direction to the camera stays within the
+// tolerance of the one it was evaluated for. Camera rotation alone never invalidates it. Out-of-core slots change
+// splats under the same index and always evaluate, so does degree 0, whose 12 byte DC term is cheaper than an entry.
+vec3 cached_color(uint index) {
+    if (color_cache_cos > 1.0 || chunk_splats > 0 || SPLAT_SH_DEGREE == 0) {
+        sh_evaluated = true;
+        return compute_sh();
+    }
+
+    vec3 direction = normalize(splat_position(index) - camera_position.xyz);
+    bool refresh = color_refresh_period > 0 && index % color_refresh_period == frame_index % color_refresh_period;
+    if (!refresh) {
+        ColorCacheEntry entry = color_cache[index];
+        if (entry.direction != COLOR_CACHE_EMPTY &&
+            dot(direction, octahedral_decode(unpackSnorm2x16(entry.direction))) >= color_cache_cos) {
+            return entry.color;
+        }
+    }
+
+    sh_evaluated = true;
+    vec3 color = compute_sh();
+    color_cache[index] = ColorCacheEntry(color, packSnorm2x16(octahedral_encode(direction)));
+    return color;
+}
+
+float ndc2Pix(float v, int S)
+{
+    return ((v + 1.0) * S - 1.0) * 0.5;
+}
+
+// fills a with the screen-space splat, false when it is culled and nothing is drawn
+bool project_splat(uint index, out VertexAttribute a, out uint num_tiles_overlap) {
+    num_tiles_overlap = 0;
+    if (index >= resident_splats) {
+        return false;
+    }
+    if (chunk_splats > 0 && index % chunk_splats >= slot_splats[index / chunk_splats]) {
+        return false;
+    }
+
+    ivec2 tile_shape = ivec2((width + TILE_WIDTH - 1) / TILE_WIDTH, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+//    assert(tile_shape.x == 50 && tile_shape.y == 38, "invalid tile shape: %d %d\n", tile_shape);
+
+    vec4 position = vec4(splat_position(index), 1.0);
+    vec4 p_hom = proj_mat * position;
+    float p_w = 1.0f / p_hom.w;
+    vec3 ndc = vec3(p_hom.xyz * p_w);
+
+    vec4 p_view = view_mat * position;
+    if (p_view.z <= 0.2f) {
+        return false;
+    }
+
+    mat2 cov2d = compute_cov2d(p_view.xyz);
+    float det = determinant(cov2d);
+    if (det <= 0.0) {
+        return false;
+    }
+    mat2 conic = inverse(cov2d);
+    float opacity = splat_opacity(index);
+    a.conic_opacity.xyz = vec3(conic[0][0], conic[0][1], conic[1][1]);
+    a.conic_opacity.w = opacity;
+
+    vec2 extent;
+    a.cutoff_sq = 0.0;
+    if (TIGHT_EXTENTS != 0u) {
+        // alpha = opacity * exp(-d^2 / 2) at Mahalanobis distance d, so alpha passes the threshold up to
+        // d = sqrt(2 ln(opacity / threshold)); capped at the 3 sigma of the square bound so no splat grows
+        if (opacity <= ALPHA_THRESHOLD) {
+            return false;
+        }
+        float cutoff = min(3.0, sqrt(2.0 * log(opacity / ALPHA_THRESHOLD)));
+        // the ellipse d = cutoff spans cutoff * sigma_x by cutoff * sigma_y, tiles in its box are tested against it
+        extent = ceil(cutoff * sqrt(vec2(cov2d[0][0], cov2d[1][1])));
+        a.cutoff_sq = cutoff * cutoff;
+    } else {
+        float mid = 0.5 * (cov2d[0][0] + cov2d[1][1]);
+        float lambda1 = mid + sqrt(max(0.1, mid * mid - det));
+        float lambda2 = mid - sqrt(max(0.1, mid * mid - det));
+        float lambda = max(lambda1, lambda2);
+        extent = vec2(ceil(3.0 * sqrt(lambda)));
+    }
+    float radii = max(extent.x, extent.y);
+//    if (radii > 2.0) {
+//        debugPrintfEXT("extent: %f %f\n", extent.x, extent.y);
+//    }
+
+//    vec2 uv = vec2((ndc.x + 1.0) * 0.5 * width, (ndc.y + 1.0) * 0.5 * height);
+    vec2 uv = vec2(ndc2Pix(ndc.x, int(width)), ndc2Pix(ndc.y, int(height)));
+
+    uvec4 bounding_box = uvec4(
+            uint(clamp(int((uv.x - extent.x) / TILE_WIDTH), 0, tile_shape.x)),
+            uint(clamp(int((uv.y - extent.y) / TILE_HEIGHT), 0, tile_shape.y)),
+            uint(clamp(int((uv.x + extent.x + TILE_WIDTH - 1) / TILE_WIDTH), 0, tile_shape.x)),
+            uint(clamp(int((uv.y + extent.y + TILE_HEIGHT - 1) / TILE_HEIGHT), 0, tile_shape.y))
+    );
+
+//    debugPrintfEXT("extent: %f %f, uv: %f %f, aabb: %d %d %d %d\n", extent.x, extent.y, uv.x, uv.y, ivec4(bounding_box));
+
+    a.uv = uv;
+    if (a.cutoff_sq > 0.0) {
+        // thin rotated splats leave most of the box untouched, only the tiles the ellipse reaches get a key
+        for (uint i = bounding_box.x; i < bounding_box.z; i++) {
+            for (uint j = bounding_box.y; j < bounding_box.w; j++) {
+                num_tiles_overlap += splat_touches_tile(a, uvec2(i, j)) ? 1u : 0u;
+            }
+        }
+    } else {
+        num_tiles_overlap = (bounding_box.z - bounding_box.x) * (bounding_box.w - bounding_box.y);
+    }
+    if (num_tiles_overlap == 0) {
+        return false;
+    }
+    assert(num_tiles_overlap <= width * height, "too many tiles overlap: %d\n", num_tiles_overlap);
+    a.aabb = bounding_box;
+//    assert(bounding_box.x < bounding_box.z && bounding_box.y < bounding_box.w, "invalid aabb: %d %d %d %d\n", ivec4(bounding_box));
+    a.depth = p_view.z;
+    a.color_radii.w = radii;
+    a.color_radii.xyz = cached_color(index);
+    return true;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    VertexAttribute a;
+    uint num_tiles_overlap = 0;
+    // every invocation takes part in the ballot, so no early return before the append
+    bool is_visible = index < splat_count() && project_splat(index, a, num_tiles_overlap);
+
+    // one atomic per subgroup: the elected invocation reserves a contiguous range for all visible lanes
+    uvec4 ballot = subgroupBallot(is_visible);
+    uint subgroup_visible = subgroupBallotBitCount(ballot);
+    uint subgroup_evaluated = subgroupBallotBitCount(subgroupBallot(sh_evaluated));
+    uint base = 0;
+    if (subgroupElect()) {
+        if (subgroup_visible > 0) {
+            base = atomicAdd(visible.count, subgroup_visible);
+            atomicMax(visible.groups_x, (base + subgroup_visible + 255) / 256);
+        }
+        if (subgroup_evaluated > 0) {
+            atomicAdd(visible.sh_evaluations, subgroup_evaluated);
+        }
+    }
+    base = subgroupBroadcastFirst(base);
+    if (!is_visible) {
+        return;
+    }
+
+    uint slot = base + subgroupBallotExclusiveBitCount(ballot);
+    attr[slot] = a;
+    tiles_overlap[slot] = num_tiles_overlap;
+}
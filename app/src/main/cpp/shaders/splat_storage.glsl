@@ -0,0 +1,252 @@
+// Read access to the resident splats, independent of how they are stored.
+// The including shader defines SPLAT_STORAGE_SET and SPLAT_VERTEX_BINDING (and SPLAT_STORAGE_DATA_BINDING for the
+// compressed and codebook layouts) before including this file; COMPRESSED_SPLATS, SH_CODEBOOK_SPLATS or HALF_SPLATS
+// selects the layout, the default is the float32 structure of arrays. Must match GSScene::SplatGeometry /
+// CompressedSplat / SplatChunk / CodebookSplat / HalfSplat on the CPU side. SPLAT_COV3D_SCALAR is the element type
+// of the cov3D buffer and SPLAT_COV3D_STRIDE the elements per splat.
+
+// SH degree the scene is loaded with (GSScene::getShDegree), higher bands are never read
+layout (constant_id = 0) const uint SPLAT_SH_DEGREE = 3;
+const uint SPLAT_SH_COEFFICIENTS = (SPLAT_SH_DEGREE + 1) * (SPLAT_SH_DEGREE + 1);
+
+#ifdef COMPRESSED_SPLATS
+
+// 64 bytes per splat:
+// data[0]  position x | y << 16, 16 bit each, relative to the chunk bounds
+// data[1]  position z | opacity << 16 (8 bit, after the sigmoid)
+// data[2]  log scale x | y << 8 | z << 16, 8 bit each, relative to the chunk range
+// data[3]  rotation, smallest three: 3 x 10 bit components, index of the dropped one in the top 2 bits
+// data[4..15] 48 SH coefficients at 8 bit, same interleaved order as Vertex.sh
+struct CompressedSplat {
+    uint data[16];
+};
+
+// quantization ranges shared by SPLAT_CHUNK_SIZE consecutive splats
+struct SplatChunk {
+    vec4 position_min;
+    vec4 position_extent;
+    vec4 scale_min;
+    vec4 scale_extent;
+    // x: band 0 (dc), y: higher bands
+    vec4 sh_min;
+    vec4 sh_extent;
+};
+
+#define SPLAT_CHUNK_SIZE 256
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_VERTEX_BINDING) readonly buffer Vertices {
+    CompressedSplat vertices[];
+};
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_STORAGE_DATA_BINDING) readonly buffer Chunks {
+    SplatChunk chunks[];
+};
+
+uint splat_count() {
+    return vertices.length();
+}
+
+vec3 splat_position(uint index) {
+    SplatChunk chunk = chunks[index / SPLAT_CHUNK_SIZE];
+    uint xy = vertices[index].data[0];
+    uint z = vertices[index].data[1] & 0xffffu;
+    vec3 q = vec3(xy & 0xffffu, xy >> 16, z) / 65535.0;
+    return chunk.position_min.xyz + q * chunk.position_extent.xyz;
+}
+
+vec3 splat_scale(uint index) {
+    SplatChunk chunk = chunks[index / SPLAT_CHUNK_SIZE];
+    uint packed = vertices[index].data[2];
+    vec3 q = vec3(packed & 0xffu, (packed >> 8) & 0xffu, (packed >> 16) & 0xffu) / 255.0;
+    return exp(chunk.scale_min.xyz + q * chunk.scale_extent.xyz);
+}
+
+float splat_opacity(uint index) {
+    return float((vertices[index].data[1] >> 16) & 0xffu) / 255.0;
+}
+
+vec4 splat_rotation(uint index) {
+    uint packed = vertices[index].data[3];
+    // the three stored components lie in [-1/sqrt(2), 1/sqrt(2)]
+    vec3 abc = (vec3(packed & 0x3ffu, (packed >> 10) & 0x3ffu, (packed >> 20) & 0x3ffu) / 1023.0 - 0.5)
+               * 1.4142135623730951;
+    float largest = sqrt(max(0.0, 1.0 - dot(abc, abc)));
+    uint dropped = packed >> 30;
+    if (dropped == 0u) {
+        return vec4(largest, abc);
+    } else if (dropped == 1u) {
+        return vec4(abc.x, largest, abc.y, abc.z);
+    } else if (dropped == 2u) {
+        return vec4(abc.x, abc.y, largest, abc.z);
+    }
+    return vec4(abc, largest);
+}
+
+float splat_sh_component(uint index, uint component, float range_min, float range_extent) {
+    uint packed = vertices[index].data[4 + component / 4];
+    float q = float((packed >> (8 * (component % 4))) & 0xffu) / 255.0;
+    return range_min + q * range_extent;
+}
+
+vec3 splat_sh(uint index, uint coefficient) {
+    SplatChunk chunk = chunks[index / SPLAT_CHUNK_SIZE];
+    float range_min = coefficient == 0 ? chunk.sh_min.x : chunk.sh_min.y;
+    float range_extent = coefficient == 0 ? chunk.sh_extent.x : chunk.sh_extent.y;
+    return vec3(splat_sh_component(index, coefficient * 3, range_min, range_extent),
+                splat_sh_component(index, coefficient * 3 + 1, range_min, range_extent),
+                splat_sh_component(index, coefficient * 3 + 2, range_min, range_extent));
+}
+
+#elif defined(SH_CODEBOOK_SPLATS)
+
+// 64 bytes per splat: full precision geometry and SH band 0, bands 1-3 are an entry of the shared codebook
+struct CodebookSplat {
+    vec4 position;
+    vec4 scale_opacity;
+    vec4 rotation;
+    vec3 sh_dc;
+    // index in the low 16 bits, the upper half is padding
+    uint sh_index;
+};
+
+#define SH_CODEBOOK_ENTRY_SIZE 45
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_VERTEX_BINDING) readonly buffer Vertices {
+    CodebookSplat vertices[];
+};
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_STORAGE_DATA_BINDING) readonly buffer ShCodebook {
+    float sh_codebook[];
+};
+
+uint splat_count() {
+    return vertices.length();
+}
+
+vec3 splat_position(uint index) {
+    return vertices[index].position.xyz;
+}
+
+vec3 splat_scale(uint index) {
+    return vertices[index].scale_opacity.xyz;
+}
+
+float splat_opacity(uint index) {
+    return vertices[index].scale_opacity.w;
+}
+
+vec4 splat_rotation(uint index) {
+    return vertices[index].rotation;
+}
+
+vec3 splat_sh(uint index, uint coefficient) {
+    if (coefficient == 0) {
+        return vertices[index].sh_dc;
+    }
+    uint base = (vertices[index].sh_index & 0xffffu) * SH_CODEBOOK_ENTRY_SIZE + (coefficient - 1) * 3;
+    return vec3(sh_codebook[base], sh_codebook[base + 1], sh_codebook[base + 2]);
+}
+
+#elif defined(HALF_SPLATS)
+
+// 128 bytes per splat, fp32 positions and binary16 for the rest; needs GL_EXT_shader_16bit_storage
+struct HalfSplat {
+    vec3 position;
+    float16_t opacity;
+    float16_t padding0;
+    f16vec4 rotation;
+    float16_t scale[3];
+    float16_t sh[48];
+};
+
+#define SPLAT_COV3D_SCALAR float16_t
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_VERTEX_BINDING) readonly buffer Vertices {
+    HalfSplat vertices[];
+};
+
+uint splat_count() {
+    return vertices.length();
+}
+
+vec3 splat_position(uint index) {
+    return vertices[index].position;
+}
+
+vec3 splat_scale(uint index) {
+    return vec3(float(vertices[index].scale[0]), float(vertices[index].scale[1]), float(vertices[index].scale[2]));
+}
+
+float splat_opacity(uint index) {
+    return float(vertices[index].opacity);
+}
+
+vec4 splat_rotation(uint index) {
+    return vec4(vertices[index].rotation);
+}
+
+vec3 splat_sh(uint index, uint coefficient) {
+    return vec3(float(vertices[index].sh[coefficient * 3]), float(vertices[index].sh[coefficient * 3 + 1]),
+                float(vertices[index].sh[coefficient * 3 + 2]));
+}
+
+#else
+
+// Structure of arrays: position.xyz and opacity in a vec4 stream (SPLAT_STORAGE_DATA_BINDING), the kept SH
+// coefficients in the vertex buffer and cov3D padded to two vec4. Preprocess reads the SH only for splats that
+// survive culling. Rotation and scale are not resident: precomp_cov3d reads them from the geometry of the batch
+// being uploaded (SPLAT_GEOMETRY_BINDING) and fills the position stream from it.
+#define SPLAT_STREAMS
+#define SPLAT_SH_FLOATS (3 * SPLAT_SH_COEFFICIENTS)
+#define SPLAT_COV3D_STRIDE 8
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_VERTEX_BINDING) readonly buffer Vertices {
+    float vertices[];
+};
+
+#ifdef SPLAT_GEOMETRY_BINDING
+struct SplatGeometry {
+    vec4 position_opacity;
+    vec4 scale;
+    vec4 rotation;
+};
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_GEOMETRY_BINDING) readonly buffer Geometry {
+    SplatGeometry geometry[];
+};
+
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_STORAGE_DATA_BINDING) buffer Positions {
+    vec4 positions[];
+};
+#else
+layout (std430, set = SPLAT_STORAGE_SET, binding = SPLAT_STORAGE_DATA_BINDING) readonly buffer Positions {
+    vec4 positions[];
+};
+#endif
+
+uint splat_count() {
+    return positions.length();
+}
+
+vec3 splat_position(uint index) {
+    return positions[index].xyz;
+}
+
+float splat_opacity(uint index) {
+    return positions[index].w;
+}
+
+vec3 splat_sh(uint index, uint coefficient) {
+    uint base = index * SPLAT_SH_FLOATS + coefficient * 3;
+    return vec3(vertices[base], vertices[base + 1], vertices[base + 2]);
+}
+
+#endif
+
+#ifndef SPLAT_COV3D_SCALAR
+#define SPLAT_COV3D_SCALAR float
+#endif
+
+#ifndef SPLAT_COV3D_STRIDE
+#define SPLAT_COV3D_STRIDE 6
+#endif
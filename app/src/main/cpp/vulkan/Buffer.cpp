@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <utility>
 #include "Buffer.h"
@@ -186,6 +187,16 @@ void Buffer::boundToDescriptorSet(std::weak_ptr<DescriptorSet> descriptorSet, ui
     boundDescriptorSets.push_back({descriptorSet, set, binding, type});
 }
 
+void Buffer::unboundFromDescriptorSet(const DescriptorSet *descriptorSet, uint32_t binding) {
+    boundDescriptorSets.erase(std::remove_if(boundDescriptorSets.begin(), boundDescriptorSets.end(),
+                                             [&](const auto& tuple) {
+                                                 auto shared = std::get<0>(tuple).lock();
+                                                 return shared == nullptr ||
+                                                        (shared.get() == descriptorSet && std::get<2>(tuple) == binding);
+                                             }),
+                              boundDescriptorSets.end());
+}
+
 std::shared_ptr<Buffer> Buffer::uniform(std::shared_ptr<VulkanContext> context, uint32_t size, bool concurrentSharing) {
     return std::make_shared<Buffer>(std::move(context), size, vk::BufferUsageFlagBits::eUniformBuffer,
                                     VMA_MEMORY_USAGE_AUTO,
@@ -201,6 +212,13 @@ std::shared_ptr<Buffer> Buffer::staging(std::shared_ptr<VulkanContext> context,
                                     false);
 }
 
+std::shared_ptr<Buffer> Buffer::readback(std::shared_ptr<VulkanContext> context, unsigned long size) {
+    return std::make_shared<Buffer>(context, size, vk::BufferUsageFlagBits::eTransferDst,
+                                    VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                           VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                                    false);
+}
+
 std::shared_ptr<Buffer> Buffer::storage(std::shared_ptr<VulkanContext> context, uint64_t size, bool concurrentSharing,
                                         vk::DeviceSize alignment, std::string debugName) {
     return std::make_shared<Buffer>(context, size,
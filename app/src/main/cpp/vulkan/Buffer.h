@@ -29,10 +29,16 @@ public:
 
     void boundToDescriptorSet(std::weak_ptr<DescriptorSet> descriptorSet, uint32_t set, uint32_t binding, vk::DescriptorType type);
 
+    // forgets every set of descriptorSet that binds this buffer at binding, so realloc stops rewriting it
+    void unboundFromDescriptorSet(const DescriptorSet *descriptorSet, uint32_t binding);
+
     static std::shared_ptr<Buffer> uniform(std::shared_ptr<VulkanContext> context, uint32_t size, bool concurrentSharing = false);
 
     static std::shared_ptr<Buffer> staging(std::shared_ptr<VulkanContext> context, unsigned long size);
 
+    // host-cached transfer destination, for reading GPU results back on the CPU
+    static std::shared_ptr<Buffer> readback(std::shared_ptr<VulkanContext> context, unsigned long size);
+
     static std::shared_ptr<Buffer> storage(std::shared_ptr<VulkanContext> context, uint64_t size, bool concurrentSharing = false, vk::DeviceSize alignment = 0, std
                                            ::string debugName = "Unnamed Storage Buffer");
 
@@ -37,7 +37,10 @@ void DescriptorSet::build() {
     std::vector<vk::DescriptorSetLayout> layouts(framesInFlight * maxOptions, descriptorSetLayout.get());
     vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo(context->descriptorPool.get(), layouts.size(),
                                                             layouts.data());
-    descriptorSets = context->device->allocateDescriptorSetsUnique(descriptorSetAllocateInfo);
+    {
+        std::lock_guard<std::mutex> lock(context->descriptorPoolMutex);
+        descriptorSets = context->device->allocateDescriptorSetsUnique(descriptorSetAllocateInfo);
+    }
 
     for (int i = 0; i < framesInFlight; i++) {
         std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
@@ -73,6 +76,28 @@ void DescriptorSet::build() {
     }
 }
 
+void DescriptorSet::updateBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer) {
+    auto& options = bindings.at(binding);
+    if (options.size() != 1 || options[0].buffer == nullptr) {
+        throw std::runtime_error("Binding " + std::to_string(binding) + " is not a single buffer binding");
+    }
+
+    auto& entry = options[0];
+    // the previous buffer must not rewrite these sets when it is reallocated later
+    entry.buffer->unboundFromDescriptorSet(this, binding);
+    entry.buffer = std::move(buffer);
+    entry.bufferInfo = vk::DescriptorBufferInfo(entry.buffer->buffer, 0, entry.buffer->size);
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (size_t i = 0; i < descriptorSets.size(); i++) {
+        entry.buffer->boundToDescriptorSet(static_cast<std::weak_ptr<DescriptorSet>>(shared_from_this()), i, binding,
+                                           entry.type);
+        writeDescriptorSets.emplace_back(descriptorSets[i].get(), binding, 0, 1, entry.type, nullptr,
+                                         &entry.bufferInfo);
+    }
+    context->device->updateDescriptorSets(writeDescriptorSets, nullptr);
+}
+
 vk::DescriptorSet DescriptorSet::getDescriptorSet(uint8_t currentFrame, uint8_t option) const {
     if (option >= maxOptions) {
         throw std::runtime_error("Invalid option " + std::to_string(option));
@@ -99,3 +124,9 @@ void DescriptorSet::bindImageToDescriptorSet(uint32_t i, vk::DescriptorType desc
 DescriptorSet::DescriptorSet(const std::shared_ptr<VulkanContext>&_context, uint8_t framesInFlight) : context(_context),
     framesInFlight(framesInFlight) {
 }
+
+DescriptorSet::~DescriptorSet() {
+    // freeing returns the sets to the shared pool
+    std::lock_guard<std::mutex> lock(context->descriptorPoolMutex);
+    descriptorSets.clear();
+}
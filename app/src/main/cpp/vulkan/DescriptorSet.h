@@ -28,10 +28,16 @@ public:
 
     explicit DescriptorSet(const std::shared_ptr<VulkanContext> &context, uint8_t framesInFlight = 1);
 
+    ~DescriptorSet();
+
     void bindBufferToDescriptorSet(uint32_t binding, vk::DescriptorType type, vk::ShaderStageFlagBits stage, std::shared_ptr<Buffer> buffer);
 
     void build();
 
+    // Points a single-buffer binding of every built set at another buffer of the same type,
+    // e.g. the splat buffers of a newly loaded scene. The set must not be in use by the GPU.
+    void updateBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer);
+
     vk::DescriptorSet getDescriptorSet(uint8_t currentFrame, uint8_t option) const;
 
     void bindImageToDescriptorSet(uint32_t i, vk::DescriptorType descriptor, vk::ShaderStageFlagBits stage, std::shared_ptr<Image> image);
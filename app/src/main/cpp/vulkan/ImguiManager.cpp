@@ -163,7 +163,7 @@ void ImguiManager::immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& fu
     vk::SubmitInfo submitInfo = {};
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &*commandBuffer;
-    context->queues[VulkanContext::Queue::GRAPHICS].queue.submit(submitInfo, *fence);
+    context->submit(VulkanContext::Queue::GRAPHICS, submitInfo, *fence);
     auto ret = context->device->waitForFences(*fence, VK_TRUE, UINT64_MAX);
     if (ret != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to wait for fence");
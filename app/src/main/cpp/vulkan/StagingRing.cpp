@@ -0,0 +1,124 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+StagingRing::StagingRing(std::shared_ptr<VulkanContext> _context, size_t capacity, size_t numChunks)
+    : context(std::move(_context)) {
+    numChunks = std::max<size_t>(numChunks, 2);
+    chunkSize = std::max<size_t>(capacity / numChunks, 64 * 1024);
+    chunks.resize(numChunks);
+    for (auto &chunk: chunks) {
+        chunk.buffer = Buffer::staging(context, chunkSize);
+        chunk.fence = context->device->createFenceUnique(vk::FenceCreateInfo());
+    }
+}
+
+StagingRing::~StagingRing() {
+    waitAll();
+}
+
+StagingRing::Chunk &StagingRing::acquire(size_t index) {
+    Chunk &chunk = chunks[index % chunks.size()];
+    if (chunk.pending) {
+        // the copy that used this chunk last has to finish before the CPU overwrites it
+        if (context->device->waitForFences(chunk.fence.get(), VK_TRUE, std::numeric_limits<uint64_t>::max()) !=
+            vk::Result::eSuccess) {
+            throw std::runtime_error("StagingRing: waiting for a chunk failed");
+        }
+        context->device->resetFences(chunk.fence.get());
+        chunk.pending = false;
+    }
+    return chunk;
+}
+
+void StagingRing::submit(Chunk &chunk) {
+    chunk.commandBuffer->end();
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &*chunk.commandBuffer;
+    context->submit(VulkanContext::Queue::TRANSFER, submitInfo, chunk.fence.get());
+    chunk.pending = true;
+}
+
+void StagingRing::waitAll() {
+    for (size_t i = 0; i < chunks.size(); i++) {
+        acquire(i);
+    }
+}
+
+void StagingRing::upload(const std::shared_ptr<Buffer> &dst, size_t count, size_t itemSize,
+                         const std::function<void(size_t, size_t, void *)> &fill, size_t itemAlignment,
+                         size_t first) {
+    if ((first + count) * itemSize > dst->size) {
+        throw std::runtime_error("StagingRing: upload larger than the destination buffer");
+    }
+    size_t itemsPerChunk = chunkSize / itemSize / itemAlignment * itemAlignment;
+    if (itemsPerChunk == 0) {
+        throw std::runtime_error("StagingRing: item does not fit into a chunk");
+    }
+
+    size_t chunkIndex = 0;
+    for (size_t begin = first; begin < first + count; begin += itemsPerChunk, chunkIndex++) {
+        size_t end = std::min(first + count, begin + itemsPerChunk);
+        Chunk &chunk = acquire(chunkIndex);
+        if (chunk.buffer == nullptr) {
+            // a download left a readback chunk in its place
+            chunk.readbackBuffer.reset();
+            chunk.buffer = Buffer::staging(context, chunkSize);
+        }
+        fill(begin, end, chunk.buffer->allocation_info.pMappedData);
+        vmaFlushAllocation(context->allocator, chunk.buffer->allocation, 0, VK_WHOLE_SIZE);
+
+        chunk.commandBuffer = context->beginOneTimeCommandBuffer(VulkanContext::Queue::TRANSFER);
+        vk::BufferCopy copyRegion = {0, begin * itemSize, (end - begin) * itemSize};
+        chunk.commandBuffer->copyBuffer(chunk.buffer->buffer, dst->buffer, 1, &copyRegion);
+        submit(chunk);
+    }
+    waitAll();
+}
+
+void StagingRing::upload(const std::shared_ptr<Buffer> &dst, const void *data, size_t size) {
+    upload(dst, size, 1, [&](size_t begin, size_t end, void *mapped) {
+        std::memcpy(mapped, static_cast<const char *>(data) + begin, end - begin);
+    });
+}
+
+void StagingRing::download(const std::shared_ptr<Buffer> &src, size_t size,
+                           const std::function<void(size_t, const void *, size_t)> &consume) {
+    if (size > src->size) {
+        throw std::runtime_error("StagingRing: download larger than the source buffer");
+    }
+
+    // chunks are handed to consume in order, keeping chunks.size() - 1 copies in flight ahead of the CPU
+    size_t numTransfers = (size + chunkSize - 1) / chunkSize;
+    auto issue = [&](size_t transfer) {
+        Chunk &chunk = acquire(transfer);
+        if (chunk.readbackBuffer == nullptr) {
+            // staging chunks are write-combined, reads go through host-cached memory that takes their place
+            chunk.buffer.reset();
+            chunk.readbackBuffer = Buffer::readback(context, chunkSize);
+        }
+        size_t offset = transfer * chunkSize;
+        chunk.commandBuffer = context->beginOneTimeCommandBuffer(VulkanContext::Queue::TRANSFER);
+        vk::BufferCopy copyRegion = {offset, 0, std::min(chunkSize, size - offset)};
+        chunk.commandBuffer->copyBuffer(src->buffer, chunk.readbackBuffer->buffer, 1, &copyRegion);
+        submit(chunk);
+    };
+
+    size_t issued = 0;
+    for (; issued < std::min(numTransfers, chunks.size() - 1); issued++) {
+        issue(issued);
+    }
+    for (size_t transfer = 0; transfer < numTransfers; transfer++) {
+        Chunk &chunk = acquire(transfer);
+        vmaInvalidateAllocation(context->allocator, chunk.readbackBuffer->allocation, 0, VK_WHOLE_SIZE);
+        size_t offset = transfer * chunkSize;
+        consume(offset, chunk.readbackBuffer->allocation_info.pMappedData, std::min(chunkSize, size - offset));
+        if (issued < numTransfers) {
+            issue(issued++);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef VULKAN_SPLATTING_STAGINGRING_H
+#define VULKAN_SPLATTING_STAGINGRING_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "VulkanContext.h"
+
+// Fixed set of host-visible chunks for streaming large buffers to and from the device.
+// While the GPU copies chunk N the CPU already fills chunk N+1; a fence per chunk guards its reuse,
+// so the host-side footprint stays at `capacity` whatever the size of the transfer.
+// Copies go to the TRANSFER queue; a ring belongs to one thread at a time.
+class StagingRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 32 * 1024 * 1024;
+
+    StagingRing(std::shared_ptr<VulkanContext> context, size_t capacity = DEFAULT_CAPACITY, size_t numChunks = 4);
+
+    StagingRing(const StagingRing &) = delete;
+
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    ~StagingRing();
+
+    // Streams items [first, first + count) of `itemSize` bytes into the same items of dst. fill(begin, end, mapped)
+    // writes items [begin, end) into the mapped chunk; chunks never split an item and begin - first is always a
+    // multiple of itemAlignment. Returns once every copy has completed.
+    void upload(const std::shared_ptr<Buffer> & dst, size_t count, size_t itemSize,
+                const std::function<void(size_t begin, size_t end, void * mapped)> & fill, size_t itemAlignment = 1,
+                size_t first = 0);
+
+    // Streams `size` bytes that already exist in host memory (e.g. a mapped file) into dst
+    void upload(const std::shared_ptr<Buffer> & dst, const void * data, size_t size);
+
+    // Copies src back chunk by chunk, consume(offset, data, bytes) sees each chunk once the GPU has written it.
+    // Reads go through host-cached chunks of the same size that replace the staging chunks until the next upload, so
+    // the ring stays within its capacity.
+    void download(const std::shared_ptr<Buffer> & src, size_t size,
+                  const std::function<void(size_t offset, const void * data, size_t bytes)> & consume);
+
+    size_t getCapacity() const { return chunkSize * chunks.size(); }
+
+private:
+    struct Chunk {
+        // at most one of the two is allocated
+        std::shared_ptr<Buffer> buffer;
+        std::shared_ptr<Buffer> readbackBuffer;
+        vk::UniqueCommandBuffer commandBuffer;
+        vk::UniqueFence fence;
+        bool pending = false;
+    };
+
+    Chunk & acquire(size_t index);
+
+    void submit(Chunk & chunk);
+
+    void waitAll();
+
+    std::shared_ptr<VulkanContext> context;
+    size_t chunkSize;
+    std::vector<Chunk> chunks;
+};
+
+#endif //VULKAN_SPLATTING_STAGINGRING_H
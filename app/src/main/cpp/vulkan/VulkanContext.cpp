@@ -1,4 +1,5 @@
 #include "VulkanContext.h"
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <unordered_map>
@@ -272,9 +273,14 @@ void VulkanContext::createLogicalDevice(vk::PhysicalDeviceFeatures deviceFeature
         indices.presentFamily.value()
     };
 
-    float queuePriority = 1.0f;
+    // the loader gets a lower priority so the frames of the current scene are not starved by a load
+    uint32_t computeFamily = indices.computeFamily.value();
+    uint32_t computeQueueCount = std::min<uint32_t>(
+        physicalDevice.getQueueFamilyProperties()[computeFamily].queueCount, 2);
+    float queuePriorities[] = {1.0f, 0.5f};
     for (auto queueFamily: uniqueQueueFamilies) {
-        queueCreateInfos.push_back({{}, queueFamily, 1, &queuePriority});
+        queueCreateInfos.push_back({{}, queueFamily, queueFamily == computeFamily ? computeQueueCount : 1,
+                                    queuePriorities});
     }
 
     deviceFeatures.samplerAnisotropy = VK_TRUE;
@@ -306,10 +312,17 @@ void VulkanContext::createLogicalDevice(vk::PhysicalDeviceFeatures deviceFeature
             types.insert(Queue::Type::PRESENT);
         }
 
+        auto mutex = std::make_shared<std::mutex>();
         for (auto type: types) {
-            queues[type] = Queue{types, unique_queue_family, 0, queue};
+            queues[type] = Queue{types, unique_queue_family, 0, queue, mutex};
         }
     }
+    if (computeQueueCount > 1) {
+        queues[Queue::Type::TRANSFER] = Queue{{Queue::Type::TRANSFER}, computeFamily, 1,
+                                              device->getQueue(computeFamily, 1), std::make_shared<std::mutex>()};
+    } else {
+        queues[Queue::Type::TRANSFER] = queues[Queue::Type::COMPUTE];
+    }
 
     LOGD("Logical device created");
 
@@ -319,9 +332,9 @@ void VulkanContext::createLogicalDevice(vk::PhysicalDeviceFeatures deviceFeature
     createQueryPool();
 }
 
-vk::UniqueCommandBuffer VulkanContext::beginOneTimeCommandBuffer() {
+vk::UniqueCommandBuffer VulkanContext::beginOneTimeCommandBuffer(Queue::Type queue) {
     auto info = vk::CommandBufferAllocateInfo()
-            .setCommandPool(*commandPool)
+            .setCommandPool(queue == Queue::Type::TRANSFER ? *transferCommandPool : *commandPool)
             .setLevel(vk::CommandBufferLevel::ePrimary)
             .setCommandBufferCount(1);
     auto commandBuffer = std::move(device->allocateCommandBuffersUnique(info)[0]);
@@ -337,8 +350,23 @@ void VulkanContext::endOneTimeCommandBuffer(vk::UniqueCommandBuffer&& commandBuf
     vk::SubmitInfo submitInfo = {};
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &*commandBuffer;
-    queues[queue].queue.submit(submitInfo, nullptr);
-    queues[queue].queue.waitIdle();
+    auto fence = device->createFenceUnique(vk::FenceCreateInfo());
+    submit(queue, submitInfo, fence.get());
+    if (device->waitForFences(fence.get(), VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for one time command buffer");
+    }
+}
+
+void VulkanContext::submit(Queue::Type queue, vk::ArrayProxy<const vk::SubmitInfo> submitInfos, vk::Fence fence) {
+    auto &target = queues.at(queue);
+    std::lock_guard<std::mutex> lock(*target.mutex);
+    target.queue.submit(submitInfos, fence);
+}
+
+vk::Result VulkanContext::present(const vk::PresentInfoKHR &presentInfo) {
+    auto &target = queues.at(Queue::Type::PRESENT);
+    std::lock_guard<std::mutex> lock(*target.mutex);
+    return target.queue.presentKHR(presentInfo);
 }
 
 void VulkanContext::setupVma() {
@@ -357,6 +385,9 @@ void VulkanContext::createCommandPool() {
     poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
 
     commandPool = device->createCommandPoolUnique(poolInfo);
+
+    poolInfo.queueFamilyIndex = queues[Queue::Type::TRANSFER].queueFamily;
+    transferCommandPool = device->createCommandPoolUnique(poolInfo);
 }
 
 void VulkanContext::createDescriptorPool(uint8_t framesInFlight) {
@@ -5,6 +5,8 @@
 
 #define FRAMES_IN_FLIGHT 1
 
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <unordered_map>
@@ -45,13 +47,18 @@ public:
         enum Type {
             GRAPHICS,
             COMPUTE,
-            PRESENT
+            PRESENT,
+            // background scene loads: uploads and load-time compute. A second queue of the compute family when
+            // the device has one, so loaded buffers need no ownership transfer; otherwise an alias of COMPUTE
+            TRANSFER
         };
 
         std::set<Type> types;
         uint32_t queueFamily;
         uint32_t queueIndex;
         vk::Queue queue;
+        // shared by every type that aliases the same vk::Queue, submits from the loader thread race otherwise
+        std::shared_ptr<std::mutex> mutex;
     };
 
     VulkanContext(const std::vector<std::string> &instance_extensions,
@@ -80,10 +87,18 @@ public:
 
     void createDescriptorPool(uint8_t framesInFlight);
 
-    vk::UniqueCommandBuffer beginOneTimeCommandBuffer();
+    // TRANSFER command buffers come from their own pool, so the loader thread never records into the pool
+    // the render thread allocates from
+    vk::UniqueCommandBuffer beginOneTimeCommandBuffer(Queue::Type queue = Queue::GRAPHICS);
 
+    // Submits and waits on a fence, other work on the same queue keeps running
     void endOneTimeCommandBuffer(vk::UniqueCommandBuffer &&commandBuffer, Queue::Type queue);
 
+    // Thread-safe vkQueueSubmit / vkQueuePresentKHR; several batches go out in one vkQueueSubmit under one fence
+    void submit(Queue::Type queue, vk::ArrayProxy<const vk::SubmitInfo> submitInfos, vk::Fence fence);
+
+    vk::Result present(const vk::PresentInfoKHR &presentInfo);
+
     virtual ~VulkanContext();
 
     vk::UniqueInstance instance;
@@ -94,6 +109,8 @@ public:
     VmaAllocator allocator;
 
     vk::UniqueDescriptorPool descriptorPool;
+    // guards descriptorPool, descriptor sets are allocated and freed on the loader thread as well
+    std::mutex descriptorPoolMutex;
     vk::UniqueQueryPool queryPool;
 
     bool validationLayersEnabled;
@@ -102,6 +119,7 @@ private:
     std::vector<std::string> deviceExtensions;
 
     vk::UniqueCommandPool commandPool;
+    vk::UniqueCommandPool transferCommandPool;
 
     void setupVma();
 
@@ -6,10 +6,18 @@ ComputePipeline::ComputePipeline(const std::shared_ptr<VulkanContext>& context,
     this->shader->load();
 }
 
+void ComputePipeline::addSpecializationConstant(uint32_t constantId, uint32_t value) {
+    specializationEntries.emplace_back(constantId, specializationData.size() * sizeof(uint32_t), sizeof(uint32_t));
+    specializationData.push_back(value);
+}
+
 void ComputePipeline::build() {
     buildPipelineLayout();
 
-    vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader->shader.get(), "main");
+    vk::SpecializationInfo specializationInfo(specializationEntries.size(), specializationEntries.data(),
+                                              specializationData.size() * sizeof(uint32_t), specializationData.data());
+    vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shader->shader.get(), "main",
+                                                                    specializationEntries.empty() ? nullptr : &specializationInfo);
     vk::ComputePipelineCreateInfo computePipelineCreateInfo({}, pipelineShaderStageCreateInfo, pipelineLayout.get());
     pipeline = context->device->createComputePipelineUnique(nullptr, computePipelineCreateInfo).value;
 }
@@ -10,9 +10,14 @@ class ComputePipeline : public Pipeline {
 public:
     explicit ComputePipeline(const std::shared_ptr<VulkanContext> &context, std::shared_ptr<Shader> shader);;
 
+    // 32-bit specialization constant, applied when the pipeline is built
+    void addSpecializationConstant(uint32_t constantId, uint32_t value);
+
     void build() override;
 private:
     std::shared_ptr<Shader> shader;
+    std::vector<vk::SpecializationMapEntry> specializationEntries;
+    std::vector<uint32_t> specializationData;
 };
 
 